@@ -12,10 +12,17 @@
 #include "VarcEntry.hpp"
 #include "CryptoEngine.hpp"
 #include "CompressionEngine.hpp"
+#include "CompressionPolicy.hpp"
+#include "FileIO.hpp"
+#include "ThreadPool.hpp"
 #include <string>
 #include <vector>
 #include <memory>
 #include <functional>
+#include <istream>
+#include <unordered_map>
+#include <map>
+#include <chrono>
 
 namespace VaultArchive {
 
@@ -45,6 +52,7 @@ namespace VaultArchive {
         uint64_t bytesProcessed;               // Bytes processed
         uint64_t timeMs;                       // Time taken in milliseconds
         CompressionStats stats;                // Compression statistics
+        std::map<std::string, CompressionStats> ruleStats;  // addFiles: files and bytes per policy rule ("" = archive-wide settings)
 
         /**
          * @brief Default constructor
@@ -52,6 +60,18 @@ namespace VaultArchive {
         ArchiveResult() : success(false), filesProcessed(0), bytesProcessed(0), timeMs(0) {}
     };
 
+    /**
+     * @brief Open options
+     */
+    struct OpenOptions {
+        bool memoryMap;                        // Map archive read-only instead of using positioned reads
+
+        /**
+         * @brief Default constructor
+         */
+        OpenOptions() : memoryMap(true) {}
+    };
+
     /**
      * @brief Extract options
      */
@@ -61,12 +81,13 @@ namespace VaultArchive {
         bool preserveTimestamps;               // Preserve timestamps
         std::string outputDirectory;           // Output directory
         std::vector<std::string> filter;       // File name filters
+        unsigned int threads;                  // Worker threads for block-split entries (0 = available cores)
 
         /**
          * @brief Default constructor
          */
         ExtractOptions() : overwrite(false), preservePermissions(true),
-                           preserveTimestamps(true), outputDirectory(".") {}
+                           preserveTimestamps(true), outputDirectory("."), threads(0) {}
     };
 
     /**
@@ -81,13 +102,34 @@ namespace VaultArchive {
         bool includeHidden;                    // Include hidden files
         std::vector<std::string> excludePatterns; // Patterns to exclude
         ArchiveMetadata metadata;              // Archive metadata
+        unsigned int threads;                  // Worker threads for addFile/addFiles (0 = available cores)
+        bool deduplicate;                      // Store identical files once (matched by SHA-256 and size)
+        bool chunkDedup;                       // Store identical content-defined chunks once
+        bool compareChecksums;                 // updateFiles: also compare SHA-256 when size and time match
+        bool solid;                            // addFiles: encode small files together in solid blocks
+        uint8_t codec;                         // Compression codec (CodecId) used when compress is set
+        CompressionPolicy policy;              // Per-entry codec, level and solid rules (empty = the settings above)
 
         /**
          * @brief Default constructor
          */
         CreateOptions() : compress(true), compressionLevel(6),
                           encrypt(false), followSymlinks(true),
-                          includeHidden(true) {}
+                          includeHidden(true), threads(0), deduplicate(false),
+                          chunkDedup(false), compareChecksums(false), solid(false),
+                          codec(CodecId::DEFLATE) {}
+    };
+
+    /**
+     * @brief Compaction options
+     */
+    struct CompactOptions {
+        uint64_t bytesPerSecond;               // Limit on payload bytes copied per second (0 = unlimited)
+
+        /**
+         * @brief Default constructor
+         */
+        CompactOptions() : bytesPerSecond(0) {}
     };
 
     /**
@@ -114,17 +156,53 @@ namespace VaultArchive {
      */
     class Archive {
     private:
+        /**
+         * @brief Where a stored chunk can be read
+         */
+        struct ChunkLocation {
+            uint64_t offset;                   // Offset of the stored chunk
+            uint32_t storedSize;               // Stored chunk size
+            bool staged;                       // Offset refers to m_output rather than m_file
+        };
+
+        /**
+         * @brief Most recently decoded solid block
+         * Consecutive entries of a solid block are decoded from one copy.
+         */
+        struct SolidBlockCache {
+            uint64_t offset;                   // Offset of the stored block
+            bool staged;                       // Offset refers to m_output rather than m_file
+            std::vector<uint8_t> data;         // Original block data (empty if nothing is cached)
+
+            SolidBlockCache() : offset(0), staged(false) {}
+        };
+
         std::string m_filepath;                // Archive file path
         GlobalHeader m_header;                 // Archive header
         VarcEntryList m_entries;               // Archive entries
-        std::vector<uint8_t> m_archiveData;    // In-memory archive data (for modifications)
+        InputFile m_file;                      // Backing archive file (entry payloads live here)
+        OpenOptions m_openOptions;             // Options used to open the backing file
+        std::unique_ptr<OutputFile> m_output;  // Archive being written (streamed entries land here)
+        std::unordered_map<std::string, size_t> m_payloadIndex; // Checksum and size -> entry holding that payload
+        size_t m_payloadIndexed;               // Leading entries covered by m_payloadIndex
+        std::unordered_map<std::string, ChunkLocation> m_chunkIndex; // Chunk ID and encoding -> stored chunk
+        std::unordered_map<uint64_t, uint64_t> m_copiedChunks; // Chunks of m_file already copied to m_output
+        SolidBlockCache m_solidCache;          // Last solid block decoded for extraction
+        VarcEntryList m_removed;               // Stored entries removed since open (tombstoned on save)
+        bool m_rewrite;                        // Entries were re-encoded or compaction requested; save() rewrites the file
+        uint64_t m_copyRate;                   // Payload copy limit in bytes per second (0 = unlimited)
+        uint64_t m_copiedBytes;                // Payload bytes copied since m_copyStart
+        std::chrono::steady_clock::time_point m_copyStart; // Start of the throttled copy
         bool m_modified;                       // Modified flag
+        bool m_keysModified;                   // Key slots changed; save() rewrites only the header
         bool m_loaded;                         // Loaded flag
         std::string m_errorMessage;            // Last error message
 
         // Crypto and compression engines
         std::unique_ptr<CryptoEngine> m_crypto;
         std::unique_ptr<CompressionEngine> m_compression;
+        std::unique_ptr<KeyCache> m_keyCache;   // Derived keys, kept across close() and open()
+        std::string m_agentSocket;             // Key agent consulted before deriving a key (empty = none)
 
         // Progress callback
         ProgressCallback m_progressCallback;
@@ -165,6 +243,18 @@ namespace VaultArchive {
          */
         bool open(const std::string& filepath, const std::string& password = "");
 
+        /**
+         * @brief Open an existing archive with options
+         * @param filepath Path to archive file
+         * @param password Password for encrypted archives (may be empty)
+         * @param options Open options
+         * @return true if successful
+         *
+         * Only the global header and entry headers are parsed; entry payloads
+         * stay in the backing file and are read when requested.
+         */
+        bool open(const std::string& filepath, const std::string& password, const OpenOptions& options);
+
         /**
          * @brief Close the archive and release resources
          */
@@ -174,6 +264,12 @@ namespace VaultArchive {
          * @brief Save modified archive
          * @param filepath Optional new filepath
          * @return true if successful
+         *
+         * Changes to an opened archive are applied in place: new entries are
+         * appended, removed entries are marked deleted in their entry headers,
+         * and a new index is appended before the header is rewritten to point
+         * at it. Archives that are new, in the old format or being compacted
+         * are rewritten to a temporary file that replaces them.
          */
         bool save(const std::string& filepath = "");
 
@@ -204,6 +300,16 @@ namespace VaultArchive {
          * @param filepath Path to file to add
          * @param options Create options
          * @return true if successful
+         *
+         * The file is read in chunks and hashed, compressed and encrypted in
+         * a single pass straight into the archive being written, so memory
+         * use does not depend on the file size. Files larger than one block
+         * are split into independently encoded blocks spread across
+         * options.threads workers. With options.deduplicate, a file whose
+         * contents are already stored is added as a reference to that
+         * payload without being compressed or written again. With
+         * options.chunkDedup, the file is cut into content-defined chunks
+         * and only chunks not yet in the archive are encoded and stored.
          */
         bool addFile(const std::string& filepath, const CreateOptions& options = CreateOptions());
 
@@ -212,9 +318,30 @@ namespace VaultArchive {
          * @param files Vector of file paths
          * @param options Create options
          * @return Archive result
+         *
+         * Files are encoded concurrently on options.threads workers; entries
+         * are still written in the order the files were given. With
+         * options.solid, small files are concatenated into solid blocks of up
+         * to 8 MiB that are encoded as one unit; larger files are written as
+         * they come, ahead of the block still being filled.
          */
         ArchiveResult addFiles(const std::vector<std::string>& files, const CreateOptions& options = CreateOptions());
 
+        /**
+         * @brief Add new and changed files, skipping unchanged ones
+         * @param files Vector of file and directory paths
+         * @param options Create options
+         * @return Archive result (filesProcessed counts added or replaced files,
+         *         message gives the number of unchanged files)
+         *
+         * A file is unchanged when an entry with the same path has the same
+         * size and modification time, and with options.compareChecksums the
+         * same SHA-256. Unchanged files are not read, and their entries keep
+         * their stored payloads, which save() copies without decoding.
+         * Changed files replace their entries.
+         */
+        ArchiveResult updateFiles(const std::vector<std::string>& files, const CreateOptions& options = CreateOptions());
+
         /**
          * @brief Add a directory recursively
          * @param dirPath Path to directory
@@ -252,6 +379,9 @@ namespace VaultArchive {
          * @brief Remove an entry by path
          * @param path Path to entry
          * @return true if successful
+         *
+         * The payload is left in place; save() marks its entry header deleted
+         * and compact() reclaims the space.
          */
         bool removeEntry(const std::string& path);
 
@@ -267,6 +397,24 @@ namespace VaultArchive {
          */
         void clearEntries();
 
+        /**
+         * @brief Rewrite the archive without unused space
+         * @param options Compaction options
+         * @return true if successful
+         *
+         * Payloads of live entries are copied as stored, without being
+         * decoded. Removed entries, superseded indexes and unreferenced
+         * chunks are dropped. The new archive is written to a temporary file
+         * that replaces the original, so readers are not disturbed.
+         */
+        bool compact(const CompactOptions& options = CompactOptions());
+
+        /**
+         * @brief Get the space in the archive file not used by live entries
+         * @return Bytes reclaimable by compact()
+         */
+        uint64_t getUnusedSize() const;
+
         // ======================
         // Extract Methods
         // ======================
@@ -290,6 +438,10 @@ namespace VaultArchive {
          * @param outputPath Output file path
          * @param password Optional password
          * @return true if successful
+         *
+         * The payload is decoded chunk by chunk and written as it is produced;
+         * the SHA-256 checksum and size are verified before returning.
+         * Blocks of block-split entries are decoded on all available cores.
          */
         bool extractFile(
             const std::string& path,
@@ -317,6 +469,29 @@ namespace VaultArchive {
          */
         std::vector<uint8_t> getEntryData(const std::string& path);
 
+        /**
+         * @brief Read part of an entry's original contents
+         * @param path Path to entry
+         * @param offset Offset within the original file
+         * @param length Number of bytes to read (clamped to the end of the entry)
+         * @param data Bytes read (output)
+         * @param password Optional password
+         * @return true if successful
+         *
+         * Only the blocks covering the range are read and decoded, so the
+         * cost does not depend on the entry size. Encrypted blocks are
+         * authenticated one by one; otherwise blocks are checked for size and
+         * the entry's SHA-256 is only verified when the whole entry is read.
+         * Other compressed or encrypted entries are decoded in full.
+         */
+        bool readRange(
+            const std::string& path,
+            uint64_t offset,
+            uint64_t length,
+            std::vector<uint8_t>& data,
+            const std::string& password = ""
+        );
+
         // ======================
         // Query Methods
         // ======================
@@ -415,16 +590,30 @@ namespace VaultArchive {
          */
         std::string list(const ListOptions& options = ListOptions()) const;
 
+        /**
+         * @brief Get archive summary (format, flags, entry count and sizes)
+         * @return Formatted summary string
+         */
+        std::string getSummary() const;
+
         /**
          * @brief Set progress callback
          * @param callback Progress callback function
          */
         void setProgressCallback(ProgressCallback callback);
 
+        /**
+         * @brief Use a key agent for derived keys
+         * @param socketPath Agent socket (empty = no agent)
+         */
+        void setKeyAgent(const std::string& socketPath);
+
         /**
          * @brief Lock archive with password
          * @param password New password
-         * @return true if successful
+         * @return true if successful (false if the archive is already encrypted)
+         *
+         * A random data key is generated and sealed in the first key slot.
          */
         bool lock(const std::string& password);
 
@@ -440,9 +629,38 @@ namespace VaultArchive {
          * @param oldPassword Current password
          * @param newPassword New password
          * @return true if successful
+         *
+         * Only the key slot of the old password is rewritten; entries keep
+         * their data key, so save() rewrites just the global header. Archives
+         * older than format 0.5 are rewritten once (payloads are copied, not
+         * re-encrypted) to make room for the key slots.
          */
         bool changePassword(const std::string& oldPassword, const std::string& newPassword);
 
+        /**
+         * @brief Add a password in an unused key slot
+         * @param password Any current password
+         * @param newPassword Password to add
+         * @return true if successful (false if all KEY_SLOT_COUNT slots are in use)
+         */
+        bool addPassword(const std::string& password, const std::string& newPassword);
+
+        /**
+         * @brief Remove a password by clearing its key slot
+         * @param password Password to remove
+         * @return true if successful (false if it is the only password)
+         *
+         * The data key is unchanged: the removed password no longer opens the
+         * archive, but a data key obtained while it did still decrypts entries.
+         */
+        bool removePassword(const std::string& password);
+
+        /**
+         * @brief Get the number of passwords that open the archive
+         * @return Active key slots (1 for archives without key slots, 0 if not encrypted)
+         */
+        size_t getPasswordCount() const;
+
         /**
          * @brief Get archive metadata
          * @return Const reference to metadata
@@ -487,10 +705,95 @@ namespace VaultArchive {
     private:
         // Internal methods
         bool readArchive(const std::string& password);
-        bool writeArchive();
+        bool readIndex();
+        bool readLegacyEntries();
+        bool commitOutput(const std::string& outputPath);
+        bool writeHeader();
+        bool writeArchive(OutputFile& output, std::vector<IndexEntry>& records);
+        bool copyEntryPayload(const VarcEntry& entry, OutputFile& output);
+        bool writeTombstones(OutputFile& output);
+        uint64_t eraseEntries(const std::function<bool(const VarcEntry&)>& matches);
+        void retireEntry(VarcEntry& entry);
+        void throttleCopy(uint64_t bytes);
+        bool copyEntryChunks(
+            const VarcEntry& entry,
+            OutputFile& output,
+            IndexEntry& record,
+            std::unordered_map<uint64_t, uint64_t>& copiedChunks
+        );
+        std::vector<uint8_t> readEntryPayload(const VarcEntry& entry) const;
+        bool readStoredData(const VarcEntry& entry, uint64_t offset, uint8_t* buffer, size_t length) const;
+        bool readArchiveData(bool staged, uint64_t offset, uint8_t* buffer, size_t length) const;
+        bool extractEntry(const VarcEntry& entry, const std::string& outputPath, ThreadPool* pool);
+        bool decodeEntry(const VarcEntry& entry, const std::function<void(const uint8_t*, size_t)>& output,
+            ThreadPool* pool = nullptr);
+        bool decodeBlocks(const VarcEntry& entry, const std::function<void(const uint8_t*, size_t)>& output,
+            ThreadPool* pool);
+        std::vector<uint8_t> decodeBlock(const VarcEntry& entry, std::vector<uint8_t> stored, size_t plainSize,
+            const SegmentCipher* stream = nullptr, uint64_t index = 0, bool last = false) const;
+        std::unique_ptr<SegmentCipher> openEntryStream(const VarcEntry& entry) const;
+        const std::vector<uint8_t>& loadSolidBlock(const VarcEntry& entry);
+        bool beginOutput(const std::string& path);
+        bool addStreamedFile(const std::string& filepath, const CreateOptions& options, ThreadPool* pool);
+        void addCollectedFiles(
+            const std::vector<std::string>& allFiles,
+            const std::vector<uint64_t>& fileSizes,
+            const CreateOptions& options,
+            const std::function<void(size_t, bool)>& finishFile
+        );
+        void addSolidFiles(
+            const std::vector<std::string>& files,
+            const std::vector<uint64_t>& fileSizes,
+            const CreateOptions& options,
+            ThreadPool* pool,
+            const std::function<void(size_t, bool)>& finished
+        );
+        bool addSharedEntry(VarcEntry& entry, const std::vector<uint8_t>& checksum);
+        const VarcEntry* findPayload(const std::vector<uint8_t>& checksum, uint64_t originalSize);
+        void updatePayloadIndex();
+        void invalidatePayloadIndex();
+        bool streamEntry(VarcEntry& entry, const std::string& filepath, const CreateOptions& options, ThreadPool* pool);
+        bool encodeFile(
+            std::istream& input,
+            const std::string& filepath,
+            VarcEntry& entry,
+            const CreateOptions& options,
+            const std::function<void(const uint8_t*, size_t)>& output,
+            std::string& error,
+            ThreadPool* pool = nullptr
+        ) const;
+        bool streamChunks(
+            std::istream& input,
+            const std::string& filepath,
+            VarcEntry& entry,
+            const CreateOptions& options,
+            ThreadPool* pool,
+            std::string& error
+        );
+        bool encodeBlocks(
+            std::istream& input,
+            const std::string& filepath,
+            VarcEntry& entry,
+            uint8_t codec,
+            int level,
+            const std::function<void(const uint8_t*, size_t)>& output,
+            std::string& error,
+            ThreadPool* pool
+        ) const;
+        std::vector<uint8_t> encodeBlock(std::vector<uint8_t> block, bool encrypt, uint8_t codec, int level,
+            const SegmentCipher* stream = nullptr, uint64_t index = 0, bool last = false) const;
+        void compressPayload(std::vector<uint8_t>& payload, uint8_t& codec, int level) const;
+        bool appendEntry(VarcEntry& entry, const std::vector<uint8_t>& payload);
         bool processEntry(VarcEntry& entry, const CreateOptions& options);
+        std::vector<uint8_t> deriveArchiveKey(const std::string& password, const std::vector<uint8_t>& salt,
+            int iterations = CryptoEngine::PBKDF2_ITERATIONS);
+        void initializeEncryption(const std::string& password);
+        void loadEncryptionKey(const std::string& password);
+        std::vector<uint8_t> unlockDataKey(const std::string& password, int& slot);
+        void sealKeySlot(KeySlot& slot, const std::string& password, const std::vector<uint8_t>& key);
+        void markKeySlotsModified();
         VarcEntry createEntryFromPath(const std::string& filepath);
-        void updateHeader();
+        void updateHeader(bool appending);
         void invokeProgress(uint64_t current, uint64_t total, uint64_t currentBytes, uint64_t totalBytes, const std::string& currentFile);
     };
 
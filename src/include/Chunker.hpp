@@ -0,0 +1,43 @@
+/**
+ * @file Chunker.hpp
+ * @brief Content-defined chunking for chunk-level deduplication
+ * @author LotusOS Core
+ * @version 1.0.0
+ */
+
+#ifndef CHUNKER_HPP
+#define CHUNKER_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+namespace VaultArchive {
+
+    /**
+     * @brief Content-defined chunker (FastCDC)
+     *
+     * Cut points are chosen by a gear rolling hash over the data itself, so
+     * an insertion or deletion only changes the chunks around it and the
+     * rest of the file still splits into the same chunks.
+     */
+    class Chunker {
+    public:
+        /**
+         * @brief Chunk size limits
+         */
+        static constexpr size_t MIN_SIZE = 16 * 1024;    // No cut point before this
+        static constexpr size_t AVG_SIZE = 64 * 1024;    // Target average chunk size
+        static constexpr size_t MAX_SIZE = 256 * 1024;   // Forced cut point
+
+        /**
+         * @brief Find the end of the next chunk
+         * @param data Data starting at the chunk
+         * @param length Available data (at least MAX_SIZE unless at end of input)
+         * @return Chunk length (length itself if no cut point is found)
+         */
+        static size_t cut(const uint8_t* data, size_t length);
+    };
+
+} // namespace VaultArchive
+
+#endif // CHUNKER_HPP
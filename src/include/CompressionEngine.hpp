@@ -12,6 +12,7 @@
 #include <string>
 #include <cstdint>
 #include <memory>
+#include <istream>
 #include <zlib.h>
 
 namespace VaultArchive {
@@ -26,6 +27,170 @@ namespace VaultArchive {
         static constexpr int BEST = 9;
     };
 
+    /**
+     * @brief Codec identifiers, recorded per entry in EntryFlags::CODEC_MASK
+     */
+    struct CodecId {
+        static constexpr uint8_t DEFLATE = 0;   // zlib DEFLATE with gzip wrapper (all archives before codecs)
+        static constexpr uint8_t STORE = 1;     // No compression
+        static constexpr uint8_t ZSTD = 2;      // Zstandard frame
+        static constexpr uint8_t LZ4 = 3;       // LZ4 block (original size kept by the entry)
+        static constexpr uint8_t MAX = 15;      // Largest id that fits the entry flags
+    };
+
+    /**
+     * @brief Compression codec
+     *
+     * Codecs compress and decompress whole buffers. They hold no state
+     * between calls and are shared by all threads.
+     */
+    class Codec {
+    public:
+        virtual ~Codec() = default;
+
+        /**
+         * @brief Get the id recorded in entries compressed by this codec
+         * @return Codec id (0 to CodecId::MAX)
+         */
+        virtual uint8_t id() const = 0;
+
+        /**
+         * @brief Get the codec name used on the command line
+         * @return Codec name
+         */
+        virtual std::string name() const = 0;
+
+        /**
+         * @brief Compress a buffer
+         * @param data Input data
+         * @param length Input length
+         * @param level Compression level (1-9, mapped to the codec's own scale)
+         * @param output Compressed data (output)
+         * @param error Error message (output)
+         * @return true if successful
+         */
+        virtual bool compress(const uint8_t* data, size_t length, int level,
+            std::vector<uint8_t>& output, std::string& error) const = 0;
+
+        /**
+         * @brief Decompress a buffer
+         * @param data Compressed data
+         * @param length Compressed length
+         * @param originalSize Decompressed size (0 if unknown)
+         * @param output Decompressed data (output)
+         * @param error Error message (output)
+         * @return true if successful
+         */
+        virtual bool decompress(const uint8_t* data, size_t length, size_t originalSize,
+            std::vector<uint8_t>& output, std::string& error) const = 0;
+    };
+
+    /**
+     * @brief Registry of the codecs this build supports
+     *
+     * deflate and store are always available; zstd and lz4 are registered
+     * when the library is built with them. Further codecs may be added
+     * before any archive is read or written.
+     */
+    class CodecRegistry {
+    public:
+        /**
+         * @brief Find a codec by id
+         * @param id Codec id
+         * @return Codec, or nullptr if not available
+         */
+        static const Codec* find(uint8_t id);
+
+        /**
+         * @brief Find a codec by name
+         * @param name Codec name
+         * @return Codec, or nullptr if not available
+         */
+        static const Codec* find(const std::string& name);
+
+        /**
+         * @brief Register a codec
+         * @param codec Codec (its id must not be taken)
+         * @return true if registered
+         */
+        static bool add(std::unique_ptr<Codec> codec);
+
+        /**
+         * @brief Get the names of all available codecs
+         * @return Codec names in id order
+         */
+        static std::vector<std::string> names();
+    };
+
+    /**
+     * @brief zlib stream leased from a per-thread pool
+     *
+     * Setting up a deflate stream allocates and clears about 256 KiB of state,
+     * more than it takes to compress a small file. Released streams are kept by
+     * their thread and reset with deflateReset()/inflateReset() for the next
+     * lease, together with the I/O buffers used with them.
+     */
+    class ZlibStream {
+    public:
+        /**
+         * @brief Stream direction
+         */
+        enum class Mode {
+            DEFLATE,
+            INFLATE
+        };
+
+        /**
+         * @brief Lease a stream, reset for new input
+         * @param mode Compress or decompress
+         * @param windowBits zlib window bits (31 = gzip wrapper, -15 = raw deflate)
+         * @param level Compression level (deflate only)
+         */
+        ZlibStream(Mode mode, int windowBits, int level = CompressionLevel::DEFAULT);
+
+        /**
+         * @brief Return the stream to the calling thread's pool
+         */
+        ~ZlibStream();
+
+        ZlibStream(const ZlibStream&) = delete;
+        ZlibStream& operator=(const ZlibStream&) = delete;
+
+        /**
+         * @brief Check whether a stream could be set up
+         * @return true if get() may be used
+         */
+        bool valid() const;
+
+        /**
+         * @brief Get the zlib stream
+         * @return Stream with counters and buffer pointers reset
+         */
+        z_stream& get();
+
+        /**
+         * @brief Get the reusable input buffer
+         * @param size Minimum size
+         * @return Buffer of at least size bytes
+         */
+        std::vector<uint8_t>& input(size_t size);
+
+        /**
+         * @brief Get the reusable output buffer
+         * @param size Minimum size
+         * @return Buffer of at least size bytes
+         */
+        std::vector<uint8_t>& output(size_t size);
+
+    private:
+        struct Context;
+        std::unique_ptr<Context> m_context;
+
+        // Streams kept per thread
+        static constexpr size_t MAX_IDLE_STREAMS = 4;
+        static std::vector<std::unique_ptr<Context>>& idleStreams();
+    };
+
     /**
      * @brief Result structure for compression operations
      */
@@ -123,6 +288,14 @@ namespace VaultArchive {
         static constexpr size_t CHUNK_SIZE = 64 * 1024;  // 64KB chunks
 
     public:
+        // Compressibility probe: estimateCompressionRatio() trial-compresses
+        // up to SAMPLE_WINDOWS windows of SAMPLE_WINDOW_SIZE bytes
+        static constexpr size_t SAMPLE_WINDOW_SIZE = 64 * 1024;
+        static constexpr size_t SAMPLE_WINDOWS = 4;
+
+        // Estimated ratio (percent) from which data is better stored uncompressed
+        static constexpr double INCOMPRESSIBLE_RATIO = 95.0;
+
         /**
          * @brief Default constructor
          * @param level Compression level (0-9, default: 6)
@@ -165,6 +338,23 @@ namespace VaultArchive {
          */
         CompressionResult compress(const std::vector<uint8_t>& data);
 
+        /**
+         * @brief Compress data with a registered codec
+         * @param data Data to compress
+         * @param codec Codec id
+         * @return Compression result
+         */
+        CompressionResult compress(const std::vector<uint8_t>& data, uint8_t codec);
+
+        /**
+         * @brief Compress data with a registered codec at a given level
+         * @param data Data to compress
+         * @param codec Codec id
+         * @param level Compression level (0-9, mapped onto the codec's own scale)
+         * @return Compression result
+         */
+        CompressionResult compress(const std::vector<uint8_t>& data, uint8_t codec, int level) const;
+
         /**
          * @brief Compress data from file
          * @param filepath Path to input file
@@ -183,6 +373,19 @@ namespace VaultArchive {
             uint64_t expectedSize = 0
         );
 
+        /**
+         * @brief Decompress data with a registered codec
+         * @param compressedData Compressed data
+         * @param expectedSize Expected decompressed size (0 for unknown)
+         * @param codec Codec id the data was compressed with
+         * @return Decompression result
+         */
+        DecompressionResult decompress(
+            const std::vector<uint8_t>& compressedData,
+            uint64_t expectedSize,
+            uint8_t codec
+        );
+
         /**
          * @brief Decompress to file
          * @param compressedData Compressed data
@@ -256,10 +459,29 @@ namespace VaultArchive {
         /**
          * @brief Estimate compression ratio for data
          * @param data Data to analyze
-         * @return Estimated compression ratio
+         * @return Estimated compressed size in percent of the original
+         *
+         * Trial-compresses evenly spaced sample windows at the fastest level;
+         * data of up to SAMPLE_WINDOWS windows is compressed whole.
          */
         static double estimateCompressionRatio(const std::vector<uint8_t>& data);
 
+        /**
+         * @brief Estimate compression ratio for data
+         * @param data Data to analyze
+         * @param length Data length
+         * @return Estimated compressed size in percent of the original
+         */
+        static double estimateCompressionRatio(const uint8_t* data, size_t length);
+
+        /**
+         * @brief Estimate compression ratio for a file by sampling it
+         * @param input Seekable input (the read position is restored)
+         * @param size Input size
+         * @return Estimated compressed size in percent of the original (0 if the input cannot be sampled)
+         */
+        static double estimateCompressionRatio(std::istream& input, uint64_t size);
+
         /**
          * @brief Get optimal compression level for data type
          * @param dataType File type identifier
@@ -281,29 +503,17 @@ namespace VaultArchive {
         result.compressedSize = 0;
         result.compressionRatio = 0.0;
 
-        // Initialize zlib
-        z_stream strm;
-        strm.zalloc = Z_NULL;
-        strm.zfree = Z_NULL;
-        strm.opaque = Z_NULL;
-
-        int ret = deflateInit2(
-            &strm,
-            m_compressionLevel,
-            Z_DEFLATED,
-            m_windowBits,
-            8,
-            Z_DEFAULT_STRATEGY
-        );
-
-        if (ret != Z_OK) {
+        ZlibStream stream(ZlibStream::Mode::DEFLATE, static_cast<int>(m_windowBits), m_compressionLevel);
+        if (!stream.valid()) {
             result.errorMessage = "Failed to initialize compression";
             return result;
         }
 
-        std::vector<uint8_t> inBuffer(CHUNK_SIZE);
-        std::vector<uint8_t> outBuffer(CHUNK_SIZE);
+        z_stream& strm = stream.get();
+        std::vector<uint8_t>& inBuffer = stream.input(CHUNK_SIZE);
+        std::vector<uint8_t>& outBuffer = stream.output(CHUNK_SIZE);
 
+        int ret = Z_OK;
         size_t bytesRead = 0;
 
         try {
@@ -327,7 +537,6 @@ namespace VaultArchive {
 
                     if (ret == Z_STREAM_ERROR) {
                         result.errorMessage = "Compression stream error";
-                        deflateEnd(&strm);
                         return result;
                     }
 
@@ -340,15 +549,12 @@ namespace VaultArchive {
 
             } while (bytesRead > 0);
 
-            deflateEnd(&strm);
-
             result.success = true;
             if (result.originalSize > 0) {
                 result.compressionRatio = (100.0 * result.compressedSize) / result.originalSize;
             }
 
         } catch (const std::exception& e) {
-            deflateEnd(&strm);
             result.errorMessage = e.what();
         }
 
@@ -366,21 +572,16 @@ namespace VaultArchive {
         result.originalSize = expectedSize;
         result.decompressedSize = 0;
 
-        // Initialize zlib
-        z_stream strm;
-        strm.zalloc = Z_NULL;
-        strm.zfree = Z_NULL;
-        strm.opaque = Z_NULL;
-
-        int ret = inflateInit2(&strm, m_windowBits);
-
-        if (ret != Z_OK) {
+        ZlibStream stream(ZlibStream::Mode::INFLATE, static_cast<int>(m_windowBits));
+        if (!stream.valid()) {
             result.errorMessage = "Failed to initialize decompression";
             return result;
         }
 
-        std::vector<uint8_t> inBuffer(CHUNK_SIZE);
-        std::vector<uint8_t> outBuffer(CHUNK_SIZE);
+        z_stream& strm = stream.get();
+        std::vector<uint8_t>& inBuffer = stream.input(CHUNK_SIZE);
+        std::vector<uint8_t>& outBuffer = stream.output(CHUNK_SIZE);
+        int ret = Z_OK;
 
         try {
             // Decompress in chunks
@@ -390,6 +591,12 @@ namespace VaultArchive {
                     break;
                 }
 
+                // Input ran out before the end of the stream
+                if (bytesRead == 0) {
+                    result.errorMessage = "Unexpected end of compressed data";
+                    return result;
+                }
+
                 strm.next_in = inBuffer.data();
                 strm.avail_in = static_cast<uInt>(bytesRead);
 
@@ -399,9 +606,9 @@ namespace VaultArchive {
 
                     ret = inflate(&strm, Z_NO_FLUSH);
 
-                    if (ret == Z_STREAM_ERROR || ret == Z_DATA_ERROR) {
+                    if (ret == Z_STREAM_ERROR || ret == Z_DATA_ERROR ||
+                        ret == Z_NEED_DICT || ret == Z_MEM_ERROR) {
                         result.errorMessage = "Decompression stream error";
-                        inflateEnd(&strm);
                         return result;
                     }
 
@@ -415,8 +622,6 @@ namespace VaultArchive {
 
             } while (ret != Z_STREAM_END);
 
-            inflateEnd(&strm);
-
             // Verify size if expected
             if (expectedSize > 0 && result.decompressedSize != expectedSize) {
                 result.errorMessage = "Decompressed size mismatch";
@@ -426,7 +631,6 @@ namespace VaultArchive {
             result.success = true;
 
         } catch (const std::exception& e) {
-            inflateEnd(&strm);
             result.errorMessage = e.what();
         }
 
@@ -0,0 +1,150 @@
+/**
+ * @file CompressionPolicy.hpp
+ * @brief Per-entry compression rules (codec, level, solid packing)
+ * @author LotusOS Core
+ * @version 1.0.0
+ */
+
+#ifndef COMPRESSIONPOLICY_HPP
+#define COMPRESSIONPOLICY_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <limits>
+
+namespace VaultArchive {
+
+    /**
+     * @brief How one entry is to be encoded
+     */
+    struct PolicyDecision {
+        uint8_t codec;                          // Codec id (CodecId::STORE = not compressed)
+        int level;                              // Compression level (0-9)
+        bool solid;                             // Pack into a solid block with other small files
+        std::string rule;                       // Rule that matched (empty = archive-wide settings)
+
+        /**
+         * @brief Default constructor
+         */
+        PolicyDecision() : codec(0), level(6), solid(false) {}
+    };
+
+    /**
+     * @brief One policy rule: a match on type, extension and size, and the actions to take
+     *
+     * Rule text is a list of whitespace-separated tokens. Matches:
+     * type=text,image,...  ext=.log,.txt  size<N  size<=N  size>N  size>=N
+     * (N in bytes, or with a K, M or G suffix). Actions: store, codec=NAME,
+     * level=N, solid. A rule must have at least one action.
+     */
+    struct PolicyRule {
+        std::string text;                       // Rule as written (names the rule in statistics)
+        std::vector<uint32_t> fileTypes;        // Detected file types to match (empty = any)
+        std::vector<std::string> extensions;    // Lower-case extensions with the dot (empty = any)
+        uint64_t minSize;                       // Smallest matching size
+        uint64_t maxSize;                       // Largest matching size
+        int codec;                              // Codec id to use (-1 = keep)
+        int level;                              // Level to use (-1 = keep)
+        bool solid;                             // Pack into solid blocks
+
+        /**
+         * @brief Default constructor (matches everything, changes nothing)
+         */
+        PolicyRule() : minSize(0), maxSize(std::numeric_limits<uint64_t>::max()),
+                       codec(-1), level(-1), solid(false) {}
+
+        /**
+         * @brief Parse a rule
+         * @param text Rule text
+         * @param rule Parsed rule
+         * @param error Error message on failure
+         * @return true if the rule is valid
+         */
+        static bool parse(const std::string& text, PolicyRule& rule, std::string& error);
+
+        /**
+         * @brief Check whether the rule applies to a file
+         * @param path File path (only the extension is used)
+         * @param fileType Detected file type
+         * @param size File size
+         * @return true if every match of the rule holds
+         */
+        bool matches(const std::string& path, uint32_t fileType, uint64_t size) const;
+    };
+
+    /**
+     * @brief Ordered list of compression rules; the first matching rule decides
+     */
+    class CompressionPolicy {
+    private:
+        std::vector<PolicyRule> m_rules;        // Rules in priority order
+
+    public:
+        /**
+         * @brief Check whether the policy has no rules
+         * @return true if entries use the archive-wide settings
+         */
+        bool empty() const;
+
+        /**
+         * @brief Get the rules
+         * @return Rules in priority order
+         */
+        const std::vector<PolicyRule>& getRules() const;
+
+        /**
+         * @brief Append a rule (it applies only where no earlier rule matches)
+         * @param rule Rule
+         */
+        void addRule(const PolicyRule& rule);
+
+        /**
+         * @brief Parse and append a rule
+         * @param text Rule text
+         * @param error Error message on failure
+         * @return true if the rule is valid
+         */
+        bool addRule(const std::string& text, std::string& error);
+
+        /**
+         * @brief Append the rules of a policy file (one rule per line, # starts a comment)
+         * @param path Policy file path
+         * @param error Error message on failure (with the line number)
+         * @return true if the file was read and every rule is valid
+         */
+        bool load(const std::string& path, std::string& error);
+
+        /**
+         * @brief Check whether any rule needs the detected file type
+         * @return true if a rule matches on type
+         */
+        bool usesFileTypes() const;
+
+        /**
+         * @brief Check whether any rule packs files into solid blocks
+         * @return true if a rule has the solid action
+         */
+        bool usesSolid() const;
+
+        /**
+         * @brief Decide how to encode a file
+         * @param path File path
+         * @param fileType Detected file type
+         * @param size File size
+         * @param defaults Archive-wide settings
+         * @return Defaults with the actions of the first matching rule applied
+         */
+        PolicyDecision decide(const std::string& path, uint32_t fileType, uint64_t size,
+            const PolicyDecision& defaults) const;
+
+        /**
+         * @brief Get the built-in policy
+         * @return Media and archives stored, files up to 16 KiB packed solid, text at level 9
+         */
+        static CompressionPolicy defaults();
+    };
+
+} // namespace VaultArchive
+
+#endif // COMPRESSIONPOLICY_HPP
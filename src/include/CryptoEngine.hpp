@@ -12,14 +12,27 @@
 #include <string>
 #include <cstdint>
 #include <array>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <chrono>
+
+// OpenSSL context types (opaque)
+struct evp_cipher_ctx_st;
+struct evp_md_ctx_st;
 
 namespace VaultArchive {
 
+    class CipherStream;
+    class SegmentCipher;
+    class SegmentStream;
+
     /**
      * @brief Cryptographic engine for encryption, decryption, and hashing
      *
      * This class provides a wrapper around OpenSSL cryptographic functions
-     * including AES-256-CBC encryption, PBKDF2 key derivation, and SHA-256 hashing.
+     * including AES-256-GCM and AES-256-CBC encryption, PBKDF2 key derivation, and SHA-256 hashing.
      */
     class CryptoEngine {
     public:
@@ -32,6 +45,9 @@ namespace VaultArchive {
         static constexpr size_t IV_SIZE = 16;             // 128 bits
         static constexpr int PBKDF2_ITERATIONS = 100000;  // OWASP recommended minimum
         static constexpr size_t HASH_SIZE = 32;           // SHA-256 output size
+        static constexpr size_t GCM_NONCE_SIZE = 12;      // 96-bit GCM nonce
+        static constexpr size_t GCM_TAG_SIZE = 16;        // 128-bit GCM tag
+        static constexpr size_t SEALED_OVERHEAD = GCM_NONCE_SIZE + GCM_TAG_SIZE; // Added by seal()
 
         /**
          * @brief Result structure for encryption operations
@@ -53,6 +69,10 @@ namespace VaultArchive {
         std::vector<uint8_t> m_key;             // Current encryption key
         std::vector<uint8_t> m_iv;              // Current IV
         bool m_initialized;                     // Initialization state
+        std::array<uint8_t, 8> m_noncePrefix;   // Random nonce prefix, drawn once per key
+        std::atomic<uint64_t> m_nonceCounter;   // Nonces handed out under the prefix
+
+        void resetNonces();
 
     public:
         /**
@@ -140,6 +160,38 @@ namespace VaultArchive {
          */
         std::vector<uint8_t> decrypt(const std::vector<uint8_t>& ciphertext);
 
+        /**
+         * @brief Create an incremental AES-256-CBC cipher with the current key and IV
+         * @param encrypt true to encrypt, false to decrypt
+         * @return Cipher stream
+         * @throws std::runtime_error if engine is not initialized
+         */
+        std::unique_ptr<CipherStream> createCipherStream(bool encrypt) const;
+
+        /**
+         * @brief Start a new segmented AEAD stream under the current key
+         * @return Segment cipher with a fresh random header
+         * @throws std::runtime_error if engine is not initialized
+         */
+        std::unique_ptr<SegmentCipher> createSegmentCipher() const;
+
+        /**
+         * @brief Open an existing segmented AEAD stream under the current key
+         * @param header Stream header (SegmentCipher::HEADER_SIZE bytes)
+         * @return Segment cipher for the stream
+         * @throws std::runtime_error if engine is not initialized or the header is invalid
+         */
+        std::unique_ptr<SegmentCipher> createSegmentCipher(const uint8_t* header) const;
+
+        /**
+         * @brief Create a sequential segmented AEAD encryptor or decryptor with the current key
+         * @param encrypt true to encrypt, false to decrypt
+         * @param segmentSize Plaintext bytes per segment
+         * @return Segment stream
+         * @throws std::runtime_error if engine is not initialized
+         */
+        std::unique_ptr<SegmentStream> createSegmentStream(bool encrypt, size_t segmentSize) const;
+
         /**
          * @brief Encrypt data with authentication (AES-256-GCM)
          * @param plaintext Data to encrypt
@@ -159,6 +211,53 @@ namespace VaultArchive {
             const std::vector<uint8_t>& tag
         );
 
+        /**
+         * @brief Encrypt data with authentication (AES-256-GCM) under a given nonce
+         * @param plaintext Data to encrypt
+         * @param nonce Nonce (GCM_NONCE_SIZE bytes, never reused with the same key)
+         * @return Encryption result containing ciphertext and tag
+         */
+        EncryptionResult encryptAuthenticated(
+            const std::vector<uint8_t>& plaintext,
+            const std::vector<uint8_t>& nonce
+        ) const;
+
+        /**
+         * @brief Decrypt authenticated data (AES-256-GCM) under a given nonce
+         * @param ciphertext Encrypted data
+         * @param tag Authentication tag
+         * @param nonce Nonce the data was encrypted with
+         * @return Decrypted data
+         * @throws std::runtime_error if authentication fails
+         */
+        std::vector<uint8_t> decryptAuthenticated(
+            const std::vector<uint8_t>& ciphertext,
+            const std::vector<uint8_t>& tag,
+            const std::vector<uint8_t>& nonce
+        ) const;
+
+        /**
+         * @brief Get the next nonce: the random prefix followed by a 32-bit counter
+         * @return Nonce (GCM_NONCE_SIZE bytes), unique for the current key
+         * @throws std::runtime_error if not initialized or 2^32 nonces were used
+         */
+        std::vector<uint8_t> nextNonce();
+
+        /**
+         * @brief Encrypt one self-contained unit with AES-256-GCM (thread-safe)
+         * @param plaintext Data to encrypt
+         * @return Nonce, ciphertext and tag (SEALED_OVERHEAD bytes longer than the input)
+         */
+        std::vector<uint8_t> seal(const std::vector<uint8_t>& plaintext);
+
+        /**
+         * @brief Decrypt and authenticate a unit written by seal() (thread-safe)
+         * @param sealed Nonce, ciphertext and tag
+         * @return Decrypted data
+         * @throws std::runtime_error if the unit is truncated, altered or the key is wrong
+         */
+        std::vector<uint8_t> unseal(const std::vector<uint8_t>& sealed) const;
+
         /**
          * @brief Calculate SHA-256 hash
          * @param data Data to hash
@@ -223,6 +322,368 @@ namespace VaultArchive {
         static std::vector<uint8_t> hexToBytes(const std::string& hex);
     };
 
+    /**
+     * @brief Cache of PBKDF2-derived keys
+     *
+     * Each key is derived once and then served from memory, so opening,
+     * listing, extracting and verifying the same archive pay for PBKDF2 only
+     * once. A key is found by salt, iteration count and password (a wrong
+     * password misses and is derived as usual). Keys live in one block that
+     * is locked in RAM where the platform allows it, and are wiped when
+     * evicted, cleared or destroyed.
+     */
+    class KeyCache {
+    public:
+        static constexpr size_t CAPACITY = 8;   // Default keys kept (least recently used is evicted)
+
+    private:
+        struct Slot {
+            std::array<uint8_t, CryptoEngine::SALT_SIZE> salt;
+            std::array<uint8_t, CryptoEngine::HASH_SIZE> password;   // HMAC-SHA256 of the password, keyed by salt
+            std::array<uint8_t, CryptoEngine::AES_KEY_SIZE> key;
+            int iterations;
+            uint64_t lastUse;                   // 0 = free
+            int64_t expires;                    // Steady-clock seconds (0 = never)
+        };
+
+        Slot* m_slots;                          // m_capacity slots in locked memory
+        size_t m_capacity;                      // Number of slots
+        std::chrono::seconds m_ttl;             // Lifetime of a key (0 = unlimited)
+        bool m_locked;                          // Slots are locked in RAM
+        uint64_t m_clock;                       // Use counter for eviction
+        mutable std::mutex m_mutex;             // Guards the slots
+
+        void wipe(Slot& slot);
+        void expireLocked(int64_t now);
+
+    public:
+        /**
+         * @brief Constructor (allocates and locks the key block)
+         * @param capacity Number of keys kept
+         * @param ttl Time a key is kept after it was stored (0 = until evicted)
+         */
+        explicit KeyCache(size_t capacity = CAPACITY, std::chrono::seconds ttl = std::chrono::seconds(0));
+
+        /**
+         * @brief Destructor (wipes every key)
+         */
+        ~KeyCache();
+
+        KeyCache(const KeyCache&) = delete;
+        KeyCache& operator=(const KeyCache&) = delete;
+
+        /**
+         * @brief Get the key for a password, deriving it on a miss
+         * @param password User password
+         * @param salt Salt for key derivation (salts of another size are not cached)
+         * @param iterations Number of PBKDF2 iterations
+         * @return Derived key (AES_KEY_SIZE bytes)
+         * @throws std::runtime_error if the password is empty
+         */
+        std::vector<uint8_t> deriveKey(
+            const std::string& password,
+            const std::vector<uint8_t>& salt,
+            int iterations = CryptoEngine::PBKDF2_ITERATIONS
+        );
+
+        /**
+         * @brief Compute the tag that identifies a password for a salt
+         * @param password User password
+         * @param salt Salt for key derivation
+         * @return HMAC-SHA256 of the password, keyed by the salt
+         */
+        static std::vector<uint8_t> passwordTag(const std::string& password, const std::vector<uint8_t>& salt);
+
+        /**
+         * @brief Look up a key without deriving it
+         * @param salt Salt for key derivation (SALT_SIZE bytes)
+         * @param iterations Number of PBKDF2 iterations
+         * @param tag Password tag from passwordTag()
+         * @param key Cached key on a hit
+         * @return true if the key was cached and has not expired
+         */
+        bool find(const std::vector<uint8_t>& salt, int iterations,
+                  const std::vector<uint8_t>& tag, std::vector<uint8_t>& key);
+
+        /**
+         * @brief Store a derived key, evicting the least recently used one when full
+         * @param salt Salt for key derivation (SALT_SIZE bytes)
+         * @param iterations Number of PBKDF2 iterations
+         * @param tag Password tag from passwordTag()
+         * @param key Derived key (AES_KEY_SIZE bytes)
+         * @return true if stored (false if a size is wrong)
+         */
+        bool insert(const std::vector<uint8_t>& salt, int iterations,
+                    const std::vector<uint8_t>& tag, const std::vector<uint8_t>& key);
+
+        /**
+         * @brief Wipe the keys whose lifetime has ended
+         */
+        void expire();
+
+        /**
+         * @brief Wipe and forget every key
+         */
+        void clear();
+
+        /**
+         * @brief Get the number of cached keys
+         * @return Cached keys
+         */
+        size_t size() const;
+
+        /**
+         * @brief Check whether the keys are locked in RAM (kept out of swap)
+         * @return true if locking succeeded
+         */
+        bool isLocked() const;
+    };
+
+    /**
+     * @brief Incremental AES-256-CBC encryption or decryption
+     *
+     * Produces the same output as CryptoEngine::encrypt()/decrypt() for the
+     * concatenated input, without holding the whole input in memory.
+     */
+    class CipherStream {
+    private:
+        evp_cipher_ctx_st* m_context;           // OpenSSL cipher context
+
+    public:
+        /**
+         * @brief Constructor
+         * @param key Encryption key (32 bytes for AES-256)
+         * @param iv Initialization vector (16 bytes)
+         * @param encrypt true to encrypt, false to decrypt
+         * @throws std::runtime_error if the cipher cannot be initialized
+         */
+        CipherStream(const std::vector<uint8_t>& key, const std::vector<uint8_t>& iv, bool encrypt);
+
+        /**
+         * @brief Destructor
+         */
+        ~CipherStream();
+
+        CipherStream(const CipherStream&) = delete;
+        CipherStream& operator=(const CipherStream&) = delete;
+
+        /**
+         * @brief Process the next piece of input
+         * @param input Input data
+         * @param length Input length
+         * @param output Output buffer (at least length + AES_BLOCK_SIZE bytes)
+         * @return Number of bytes written to output
+         * @throws std::runtime_error on failure
+         */
+        size_t update(const uint8_t* input, size_t length, uint8_t* output);
+
+        /**
+         * @brief Finish the stream (adds or checks PKCS#7 padding)
+         * @param output Output buffer (at least AES_BLOCK_SIZE bytes)
+         * @return Number of bytes written to output
+         * @throws std::runtime_error on failure (corrupted data or wrong password)
+         */
+        size_t finalize(uint8_t* output);
+    };
+
+    /**
+     * @brief Segmented AEAD (the STREAM construction over AES-256-GCM)
+     *
+     * A stream is a HEADER_SIZE header followed by segments. Segment i is
+     * sealed under the nonce prefix || i || last-segment flag with a stream
+     * key derived from the archive key and the header, and carries its own
+     * TAG_SIZE tag. Any segment can be opened on its own, on any thread,
+     * while reordered, repeated, dropped or truncated segments fail to open.
+     */
+    class SegmentCipher {
+    public:
+        static constexpr uint8_t VERSION = 1;                // Header format version
+        static constexpr size_t SALT_SIZE = 16;              // Random salt for the stream key
+        static constexpr size_t PREFIX_SIZE = 7;             // Random nonce prefix
+        static constexpr size_t HEADER_SIZE = 1 + SALT_SIZE + PREFIX_SIZE;
+        static constexpr size_t TAG_SIZE = CryptoEngine::GCM_TAG_SIZE;
+        static constexpr uint64_t MAX_SEGMENTS = 1ULL << 32; // The counter is 32 bits
+        static constexpr size_t DEFAULT_SEGMENT_SIZE = 64 * 1024;
+
+    private:
+        std::vector<uint8_t> m_header;          // Version, salt and nonce prefix
+        std::vector<uint8_t> m_key;             // Stream key
+
+        std::array<uint8_t, CryptoEngine::GCM_NONCE_SIZE> nonce(uint64_t index, bool last) const;
+
+    public:
+        /**
+         * @brief Start a new stream with a random header
+         * @param key Archive key (AES_KEY_SIZE bytes)
+         * @throws std::runtime_error if the key size is wrong
+         */
+        explicit SegmentCipher(const std::vector<uint8_t>& key);
+
+        /**
+         * @brief Open an existing stream
+         * @param key Archive key (AES_KEY_SIZE bytes)
+         * @param header Stream header (HEADER_SIZE bytes)
+         * @throws std::runtime_error if the key size or header version is wrong
+         */
+        SegmentCipher(const std::vector<uint8_t>& key, const uint8_t* header);
+
+        /**
+         * @brief Destructor (wipes the stream key)
+         */
+        ~SegmentCipher();
+
+        SegmentCipher(const SegmentCipher&) = delete;
+        SegmentCipher& operator=(const SegmentCipher&) = delete;
+
+        /**
+         * @brief Get the stream header, stored before the first segment
+         * @return Header (HEADER_SIZE bytes)
+         */
+        const std::vector<uint8_t>& getHeader() const;
+
+        /**
+         * @brief Encrypt one segment (thread-safe)
+         * @param index Segment number
+         * @param last true for the final segment of the stream
+         * @param input Plaintext
+         * @param length Plaintext length
+         * @param output Output buffer (at least length + TAG_SIZE bytes)
+         * @return Bytes written (length + TAG_SIZE)
+         * @throws std::runtime_error if the index is out of range
+         */
+        size_t seal(uint64_t index, bool last, const uint8_t* input, size_t length, uint8_t* output) const;
+
+        /**
+         * @brief Decrypt and authenticate one segment (thread-safe)
+         * @param index Segment number
+         * @param last true for the final segment of the stream
+         * @param input Sealed segment (ciphertext and tag)
+         * @param length Sealed length (at least TAG_SIZE)
+         * @param output Output buffer (at least length - TAG_SIZE bytes)
+         * @return Bytes written (length - TAG_SIZE)
+         * @throws std::runtime_error if the segment is altered, out of place or the key is wrong
+         */
+        size_t open(uint64_t index, bool last, const uint8_t* input, size_t length, uint8_t* output) const;
+
+        /**
+         * @brief Get the number of segments of a stream cut into fixed-size segments
+         * @param plaintextSize Total plaintext size
+         * @param segmentSize Plaintext bytes per segment
+         * @return Segments (an empty stream has one empty final segment)
+         */
+        static uint64_t segmentCount(uint64_t plaintextSize, size_t segmentSize);
+
+        /**
+         * @brief Get the stored size of a stream cut into fixed-size segments
+         * @param plaintextSize Total plaintext size
+         * @param segmentSize Plaintext bytes per segment
+         * @return Header, ciphertext and tags
+         */
+        static uint64_t sealedSize(uint64_t plaintextSize, size_t segmentSize);
+
+        /**
+         * @brief Get where a segment starts in a stream cut into fixed-size segments
+         * @param index Segment number
+         * @param segmentSize Plaintext bytes per segment
+         * @return Offset from the start of the header
+         */
+        static uint64_t segmentOffset(uint64_t index, size_t segmentSize);
+    };
+
+    /**
+     * @brief Sequential segmented AEAD encryption or decryption
+     *
+     * Cuts the input into fixed-size segments (see SegmentCipher), holding at
+     * most one segment in memory. Output of decryption is authenticated
+     * segment by segment; finalize() fails if the stream was cut short.
+     */
+    class SegmentStream {
+    public:
+        using Output = std::function<void(const uint8_t*, size_t)>;
+
+    private:
+        std::vector<uint8_t> m_key;             // Archive key
+        std::unique_ptr<SegmentCipher> m_cipher;// Created at once (encrypt) or from the header (decrypt)
+        bool m_encrypt;                         // Direction
+        size_t m_segmentSize;                   // Plaintext bytes per segment
+        uint64_t m_index;                       // Next segment number
+        std::vector<uint8_t> m_pending;         // Input not yet processed
+        std::vector<uint8_t> m_output;          // Output of one segment
+
+        void process(bool last, const Output& output);
+
+    public:
+        /**
+         * @brief Constructor
+         * @param key Archive key (AES_KEY_SIZE bytes)
+         * @param encrypt true to encrypt, false to decrypt
+         * @param segmentSize Plaintext bytes per segment
+         * @throws std::runtime_error if the key size or segment size is invalid
+         */
+        SegmentStream(const std::vector<uint8_t>& key, bool encrypt,
+                      size_t segmentSize = SegmentCipher::DEFAULT_SEGMENT_SIZE);
+
+        /**
+         * @brief Destructor (wipes buffered data)
+         */
+        ~SegmentStream();
+
+        SegmentStream(const SegmentStream&) = delete;
+        SegmentStream& operator=(const SegmentStream&) = delete;
+
+        /**
+         * @brief Process the next piece of input
+         * @param input Input data
+         * @param length Input length
+         * @param output Receives whole segments (the header first when encrypting)
+         * @throws std::runtime_error if a segment fails to authenticate
+         */
+        void update(const uint8_t* input, size_t length, const Output& output);
+
+        /**
+         * @brief Finish the stream (seals or opens the final segment)
+         * @param output Receives the final segment
+         * @throws std::runtime_error if the stream is truncated or fails to authenticate
+         */
+        void finalize(const Output& output);
+    };
+
+    /**
+     * @brief Incremental SHA-256 hash
+     */
+    class HashStream {
+    private:
+        evp_md_ctx_st* m_context;               // OpenSSL digest context
+
+    public:
+        /**
+         * @brief Constructor
+         * @throws std::runtime_error if the digest cannot be initialized
+         */
+        HashStream();
+
+        /**
+         * @brief Destructor
+         */
+        ~HashStream();
+
+        HashStream(const HashStream&) = delete;
+        HashStream& operator=(const HashStream&) = delete;
+
+        /**
+         * @brief Hash the next piece of input
+         * @param data Input data
+         * @param length Input length
+         */
+        void update(const uint8_t* data, size_t length);
+
+        /**
+         * @brief Finish the hash
+         * @return SHA-256 hash (32 bytes)
+         */
+        std::vector<uint8_t> finalize();
+    };
+
 } // namespace VaultArchive
 
 #endif // CRYPTOENGINE_HPP
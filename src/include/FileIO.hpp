@@ -0,0 +1,272 @@
+/**
+ * @file FileIO.hpp
+ * @brief Low-level file access used by VaultArchive for archive I/O
+ * @author LotusOS Core
+ * @version 1.0.0
+ */
+
+#ifndef FILEIO_HPP
+#define FILEIO_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace VaultArchive {
+
+    /**
+     * @brief Read-only random access to a file on disk
+     *
+     * The file is either memory-mapped read-only, in which case its
+     * contents can be addressed directly through data(), or read on demand
+     * with positioned reads when mapping is not requested or not available.
+     * Nothing beyond the requested byte ranges is ever loaded into memory.
+     */
+    class InputFile {
+    private:
+        std::string m_path;                     // Path of the open file
+        uint64_t m_size;                        // File size in bytes
+        const uint8_t* m_view;                  // Mapped view (nullptr if not mapped)
+        bool m_open;                            // Open state
+
+#ifdef _WIN32
+        void* m_fileHandle;                     // Win32 file handle
+        void* m_mappingHandle;                  // Win32 file mapping handle
+#else
+        int m_fd;                               // POSIX file descriptor
+#endif
+
+    public:
+        /**
+         * @brief Default constructor
+         */
+        InputFile();
+
+        /**
+         * @brief Destructor (unmaps and closes the file)
+         */
+        ~InputFile();
+
+        InputFile(const InputFile&) = delete;
+        InputFile& operator=(const InputFile&) = delete;
+
+        /**
+         * @brief Open a file for reading
+         * @param path Path to file
+         * @param memoryMap Map the file read-only instead of using positioned reads
+         * @return true if successful
+         */
+        bool open(const std::string& path, bool memoryMap = true);
+
+        /**
+         * @brief Unmap and close the file
+         */
+        void close();
+
+        /**
+         * @brief Check if a file is open
+         * @return true if open
+         */
+        bool isOpen() const;
+
+        /**
+         * @brief Check if the file is memory-mapped
+         * @return true if mapped
+         */
+        bool isMapped() const;
+
+        /**
+         * @brief Get file size
+         * @return Size in bytes
+         */
+        uint64_t size() const;
+
+        /**
+         * @brief Get path of the open file
+         * @return File path
+         */
+        const std::string& path() const;
+
+        /**
+         * @brief Get pointer to the mapped file contents
+         * @return Pointer to first byte (nullptr if the file is not mapped)
+         */
+        const uint8_t* data() const;
+
+        /**
+         * @brief Copy a byte range out of the file
+         * @param offset Offset from start of file
+         * @param buffer Destination buffer
+         * @param length Number of bytes to copy
+         * @return true if the whole range was read
+         */
+        bool read(uint64_t offset, uint8_t* buffer, size_t length) const;
+
+        /**
+         * @brief Copy a byte range out of the file
+         * @param offset Offset from start of file
+         * @param length Number of bytes to copy
+         * @return Byte vector (empty if the range is out of bounds)
+         */
+        std::vector<uint8_t> read(uint64_t offset, size_t length) const;
+
+        /**
+         * @brief Hint that a byte range is about to be read front to back
+         * @param offset Offset from start of file
+         * @param length Length of the range
+         *
+         * Lets the kernel read ahead so disk I/O overlaps with processing.
+         */
+        void adviseSequential(uint64_t offset, uint64_t length) const;
+
+    private:
+        bool openHandle(const std::string& path);
+        bool map();
+        void unmap();
+        void closeHandle();
+    };
+
+    /**
+     * @brief Buffered writer that replaces a file atomically
+     *
+     * Output goes to a temporary file created next to the target. commit()
+     * flushes and syncs it and renames it over the target, so readers never
+     * observe a partially written file. The temporary file is removed if
+     * the writer is destroyed without being committed.
+     *
+     * Opened with append(), output goes to the end of the target itself and
+     * commit() only flushes and syncs it. Until something before the original
+     * end has been overwritten, an uncommitted append is truncated away.
+     */
+    class OutputFile {
+    private:
+        std::string m_targetPath;               // Final file path
+        std::string m_tempPath;                 // Temporary file path
+        uint64_t m_position;                    // Logical write position
+        uint64_t m_appendStart;                 // Original size of an appended file
+        std::vector<uint8_t> m_buffer;          // Pending output
+        bool m_open;                            // Open state
+        bool m_appending;                       // Writing to the end of the target itself
+        bool m_overwritten;                     // Data before m_appendStart was rewritten
+
+#ifdef _WIN32
+        void* m_fileHandle;                     // Win32 file handle
+#else
+        int m_fd;                               // POSIX file descriptor
+#endif
+
+        static constexpr size_t BUFFER_SIZE = 1024 * 1024;  // 1MB write buffer
+
+    public:
+        /**
+         * @brief Default constructor
+         */
+        OutputFile();
+
+        /**
+         * @brief Destructor (discards uncommitted output)
+         */
+        ~OutputFile();
+
+        OutputFile(const OutputFile&) = delete;
+        OutputFile& operator=(const OutputFile&) = delete;
+
+        /**
+         * @brief Create a temporary file that will replace targetPath
+         * @param targetPath Path of the file to replace on commit
+         * @return true if successful
+         */
+        bool create(const std::string& targetPath);
+
+        /**
+         * @brief Open an existing file to write past its end
+         * @param targetPath Path of the file to extend
+         * @return true if successful
+         */
+        bool append(const std::string& targetPath);
+
+        /**
+         * @brief Check whether the target itself is being extended
+         * @return true if opened with append()
+         */
+        bool isAppending() const;
+
+        /**
+         * @brief Reserve disk space for the expected output size
+         * @param size Expected final size in bytes
+         * @return true if space was reserved (false is not fatal)
+         */
+        bool preallocate(uint64_t size);
+
+        /**
+         * @brief Append data at the current position
+         * @param data Data to write
+         * @param length Number of bytes
+         * @return true if successful
+         */
+        bool write(const uint8_t* data, size_t length);
+
+        /**
+         * @brief Append data at the current position
+         * @param data Data to write
+         * @return true if successful
+         */
+        bool write(const std::vector<uint8_t>& data);
+
+        /**
+         * @brief Overwrite already written data
+         * @param offset Offset from start of file
+         * @param data Data to write
+         * @param length Number of bytes
+         * @return true if successful
+         */
+        bool writeAt(uint64_t offset, const uint8_t* data, size_t length);
+
+        /**
+         * @brief Read back already written data
+         * @param offset Offset from start of file
+         * @param buffer Destination buffer
+         * @param length Number of bytes
+         * @return true if the whole range was read
+         */
+        bool read(uint64_t offset, uint8_t* buffer, size_t length);
+
+        /**
+         * @brief Get current write position
+         * @return Offset from start of file
+         */
+        uint64_t position() const;
+
+        /**
+         * @brief Get path of the file replaced on commit
+         * @return Target path
+         */
+        const std::string& targetPath() const;
+
+        /**
+         * @brief Flush buffered output and sync it to disk
+         * @return true if successful
+         */
+        bool sync();
+
+        /**
+         * @brief Flush, sync and rename the temporary file over the target
+         * @return true if successful (appended files are synced in place)
+         */
+        bool commit();
+
+        /**
+         * @brief Discard the temporary file (or truncate an appended file back)
+         */
+        void abort();
+
+    private:
+        bool flush();
+        bool writeRaw(const uint8_t* data, size_t length);
+        void closeHandle();
+    };
+
+} // namespace VaultArchive
+
+#endif // FILEIO_HPP
@@ -0,0 +1,127 @@
+/**
+ * @file KeyAgent.hpp
+ * @brief Key agent that keeps derived archive keys across varc runs
+ * @author LotusOS Core
+ * @version 1.0.0
+ */
+
+#ifndef KEYAGENT_HPP
+#define KEYAGENT_HPP
+
+#include "CryptoEngine.hpp"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+
+namespace VaultArchive {
+
+    /**
+     * @brief Key agent serving derived keys over a Unix domain socket
+     *
+     * Keys are looked up by archive salt, PBKDF2 iteration count and password
+     * tag (KeyCache::passwordTag), so a client must still know the password;
+     * the agent only saves the key derivation. Keys expire after the TTL.
+     * Only processes of the user running the agent may connect. Not
+     * available on Windows.
+     */
+    class KeyAgent {
+    public:
+        static constexpr const char* SOCKET_ENV = "VARC_AGENT_SOCK";   // Environment variable with the socket path
+        static constexpr int DEFAULT_TTL = 600;                         // Default key lifetime in seconds
+        static constexpr size_t CAPACITY = 64;                          // Keys kept by the agent
+
+    private:
+        std::string m_socketPath;               // Socket the agent listens on
+        KeyCache m_cache;                       // Keys with their expiry
+        int m_listenFd;                         // Listening socket (-1 = not started)
+        std::atomic<bool> m_stopping;           // Stop requested
+        std::string m_errorMessage;             // Last error message
+
+        void serve(int fd);
+
+    public:
+        /**
+         * @brief Constructor
+         * @param socketPath Socket path to listen on
+         * @param ttl Time a key is kept after it was stored
+         */
+        KeyAgent(const std::string& socketPath, std::chrono::seconds ttl = std::chrono::seconds(DEFAULT_TTL));
+
+        /**
+         * @brief Destructor (closes and removes the socket, wipes every key)
+         */
+        ~KeyAgent();
+
+        KeyAgent(const KeyAgent&) = delete;
+        KeyAgent& operator=(const KeyAgent&) = delete;
+
+        /**
+         * @brief Create the socket (mode 0600; a stale socket is replaced)
+         * @return true if the agent is ready to run
+         */
+        bool start();
+
+        /**
+         * @brief Serve requests until stop() is called
+         */
+        void run();
+
+        /**
+         * @brief Ask run() to return (safe to call from a signal handler)
+         */
+        void stop();
+
+        /**
+         * @brief Get the socket path
+         * @return Socket path
+         */
+        const std::string& getSocketPath() const;
+
+        /**
+         * @brief Get the last error message
+         * @return Error message
+         */
+        const std::string& getLastError() const;
+
+        /**
+         * @brief Check whether key agents work on this platform
+         * @return true on Unix-like systems
+         */
+        static bool isSupported();
+
+        /**
+         * @brief Get the default socket path
+         * @return $XDG_RUNTIME_DIR/varc-agent.sock, else /tmp/varc-<uid>/agent.sock
+         */
+        static std::string defaultSocketPath();
+
+        /**
+         * @brief Ask an agent for a key
+         * @param socketPath Agent socket
+         * @param salt Archive salt (SALT_SIZE bytes)
+         * @param iterations Number of PBKDF2 iterations
+         * @param tag Password tag from KeyCache::passwordTag()
+         * @param key Key on a hit
+         * @return true if the agent had the key (false on a miss or if no agent answers)
+         */
+        static bool fetch(const std::string& socketPath, const std::vector<uint8_t>& salt, int iterations,
+                          const std::vector<uint8_t>& tag, std::vector<uint8_t>& key);
+
+        /**
+         * @brief Hand a derived key to an agent
+         * @param socketPath Agent socket
+         * @param salt Archive salt (SALT_SIZE bytes)
+         * @param iterations Number of PBKDF2 iterations
+         * @param tag Password tag from KeyCache::passwordTag()
+         * @param key Derived key (AES_KEY_SIZE bytes)
+         * @return true if the agent stored the key
+         */
+        static bool store(const std::string& socketPath, const std::vector<uint8_t>& salt, int iterations,
+                          const std::vector<uint8_t>& tag, const std::vector<uint8_t>& key);
+    };
+
+} // namespace VaultArchive
+
+#endif // KEYAGENT_HPP
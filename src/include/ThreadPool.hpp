@@ -0,0 +1,95 @@
+/**
+ * @file ThreadPool.hpp
+ * @brief Fixed-size worker pool for parallel archive operations
+ * @author LotusOS Core
+ * @version 1.0.0
+ */
+
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+namespace VaultArchive {
+
+    /**
+     * @brief Fixed-size pool of worker threads
+     *
+     * Tasks are run in submission order by the first free worker. The
+     * destructor finishes all queued tasks before joining the workers.
+     */
+    class ThreadPool {
+    private:
+        std::vector<std::thread> m_workers;         // Worker threads
+        std::queue<std::function<void()>> m_tasks;  // Pending tasks
+        std::mutex m_mutex;                         // Guards m_tasks and m_stopping
+        std::condition_variable m_condition;        // Signals new tasks or shutdown
+        bool m_stopping;                            // Shutdown requested
+
+    public:
+        /**
+         * @brief Constructor
+         * @param threads Number of worker threads (at least one is started)
+         */
+        explicit ThreadPool(unsigned int threads);
+
+        /**
+         * @brief Destructor (runs remaining tasks and joins the workers)
+         */
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /**
+         * @brief Get number of worker threads
+         * @return Worker count
+         */
+        size_t size() const;
+
+        /**
+         * @brief Queue a task
+         * @param task Callable taking no arguments
+         * @return Future for the task's result (rethrows the task's exception)
+         */
+        template<typename Task>
+        auto submit(Task task) -> std::future<decltype(task())>;
+
+        /**
+         * @brief Get the number of CPUs this process may use
+         * @return Core count, limited by CPU affinity and cgroup CPU quota (at least 1)
+         */
+        static unsigned int availableCores();
+
+    private:
+        void workerLoop();
+    };
+
+    // Template implementations
+
+    template<typename Task>
+    auto ThreadPool::submit(Task task) -> std::future<decltype(task())> {
+        using Result = decltype(task());
+
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+        std::future<Result> future = packaged->get_future();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.emplace([packaged]() { (*packaged)(); });
+        }
+
+        m_condition.notify_one();
+        return future;
+    }
+
+} // namespace VaultArchive
+
+#endif // THREADPOOL_HPP
@@ -26,7 +26,16 @@ namespace VaultArchive {
         static constexpr uint32_t SYMLINK = 0x0008;        // Entry is a symbolic link
         static constexpr uint32_t HIDDEN = 0x0010;         // Entry is hidden
         static constexpr uint32_t READONLY = 0x0020;       // Entry is read-only
-        static constexpr uint32_t RESERVED = 0xFFC0;       // Reserved for future use
+        static constexpr uint32_t BLOCKED = 0x0040;        // Payload is split into independently encoded blocks
+        static constexpr uint32_t CHUNKED = 0x0080;        // Data is a list of shared, content-defined chunks
+        static constexpr uint32_t DELETED = 0x0100;        // Entry header of a removed entry (tombstone)
+        static constexpr uint32_t SOLID = 0x0200;          // Data is a slice of a shared solid block
+        static constexpr uint32_t COMPRESSED_FIRST = 0x0400; // Encrypted payload was compressed first (else encrypted, then compressed)
+        static constexpr uint32_t AUTHENTICATED = 0x0800;  // Encrypted units are AES-256-GCM (nonce, ciphertext, tag)
+        static constexpr uint32_t STREAMED = 0x1000;       // Encrypted blocks form one segmented AEAD stream (header in block 0)
+        static constexpr uint32_t RESERVED = 0xE000;       // Reserved for future use
+        static constexpr uint32_t CODEC_MASK = 0x000F0000; // Compression codec id (see CodecId, 0 = deflate)
+        static constexpr uint32_t CODEC_SHIFT = 16;
     };
 
     /**
@@ -55,6 +64,11 @@ namespace VaultArchive {
         std::chrono::system_clock::time_point m_modificationTime;
         std::vector<uint8_t> m_checksum; // SHA-256 checksum of original data
         std::vector<uint8_t> m_data;     // File data (loaded on demand)
+        bool m_loaded;                    // Data is held in m_data rather than the archive file
+        bool m_staged;                    // Payload already written to the archive being saved
+        BlockIndex m_blocks;              // Block layout of a block-split payload
+        ChunkList m_chunks;               // Chunks of a chunk-deduplicated entry
+        SolidBlockRef m_solid;            // Solid block holding the entry's data
 
     public:
         /**
@@ -180,6 +194,24 @@ namespace VaultArchive {
          */
         bool isEncrypted() const;
 
+        /**
+         * @brief Check if an encrypted payload was compressed before it was encrypted
+         * @return true if compressed first; false for the older encrypt-then-compress order
+         */
+        bool isCompressedFirst() const;
+
+        /**
+         * @brief Check if an encrypted payload is authenticated (AES-256-GCM)
+         * @return true if each stored unit carries its nonce and tag; false for AES-256-CBC
+         */
+        bool isAuthenticated() const;
+
+        /**
+         * @brief Check if the encrypted blocks are segments of one stream (see SegmentCipher)
+         * @return true if block 0 starts with the stream header; false if each block is sealed on its own
+         */
+        bool isStreamed() const;
+
         /**
          * @brief Check if entry is a directory
          * @return true if directory
@@ -192,6 +224,72 @@ namespace VaultArchive {
          */
         bool isSymlink() const;
 
+        /**
+         * @brief Check if the payload is split into independently encoded blocks
+         * @return true if block-split (see getBlockIndex())
+         */
+        bool isBlocked() const;
+
+        /**
+         * @brief Get block layout of a block-split payload
+         * @return Block index (empty unless isBlocked())
+         */
+        const BlockIndex& getBlockIndex() const;
+
+        /**
+         * @brief Set block layout and mark the payload as block-split
+         * @param blocks Block index
+         */
+        void setBlockIndex(const BlockIndex& blocks);
+
+        /**
+         * @brief Check if the data is stored as a list of shared chunks
+         * @return true if chunk-deduplicated (see getChunkList())
+         */
+        bool isChunked() const;
+
+        /**
+         * @brief Get chunks of a chunk-deduplicated entry
+         * @return Chunk list (empty unless isChunked())
+         */
+        const ChunkList& getChunkList() const;
+
+        /**
+         * @brief Set chunks and mark the entry as chunk-deduplicated
+         * @param chunks Chunk list
+         */
+        void setChunkList(const ChunkList& chunks);
+
+        /**
+         * @brief Check if the data is stored in a solid block with other entries
+         * @return true if solid (see getSolidBlock())
+         */
+        bool isSolid() const;
+
+        /**
+         * @brief Get the solid block holding the entry's data
+         * @return Block reference (empty unless isSolid())
+         */
+        const SolidBlockRef& getSolidBlock() const;
+
+        /**
+         * @brief Set the solid block and mark the entry as solid
+         * @param block Block reference
+         */
+        void setSolidBlock(const SolidBlockRef& block);
+
+        /**
+         * @brief Get the codec the payload was compressed with
+         * @return Codec id (meaningful only if isCompressed())
+         */
+        uint8_t getCodec() const;
+
+        /**
+         * @brief Set the codec the payload was compressed with
+         * @param codec Codec id (0-15)
+         */
+        void setCodec(uint8_t codec);
+
         /**
          * @brief Get creation time
          * @return Creation timestamp
@@ -251,6 +349,24 @@ namespace VaultArchive {
          */
         void clearData();
 
+        /**
+         * @brief Check if entry data is held in memory
+         * @return true if data was set; false if the payload lives in the archive file at getOffset()
+         */
+        bool isLoaded() const;
+
+        /**
+         * @brief Check if the payload was streamed into the archive being saved
+         * @return true if getOffset() refers to the pending output rather than the open archive file
+         */
+        bool isStaged() const;
+
+        /**
+         * @brief Mark the payload as streamed into the archive being saved
+         * @param staged Staged state
+         */
+        void setStaged(bool staged);
+
         /**
          * @brief Get entry header for serialization
          * @param pathLength Path length value (output)
@@ -258,6 +374,19 @@ namespace VaultArchive {
          */
         EntryHeader getEntryHeader(uint32_t& pathLength) const;
 
+        /**
+         * @brief Get entry index record for serialization
+         * @return Index record (data offset taken from getOffset())
+         */
+        IndexEntry getIndexEntry() const;
+
+        /**
+         * @brief Create entry from an index record
+         * @param record Index record
+         * @return Entry referencing its payload at record.dataOffset
+         */
+        static VarcEntry fromIndexEntry(const IndexEntry& record);
+
         /**
          * @brief Get the serialized path data
          * @return Path as byte vector
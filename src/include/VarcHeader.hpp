@@ -19,13 +19,28 @@ namespace VaultArchive {
      * @brief Archive format version constants
      */
     constexpr uint16_t VARC_VERSION_MAJOR = 0;
-    constexpr uint16_t VARC_VERSION_MINOR = 3;
+    constexpr uint16_t VARC_VERSION_MINOR = 5;
+
+    /**
+     * @brief First format version that stores a trailing entry index
+     */
+    constexpr uint16_t VARC_VERSION_INDEX = (0 << 8) | 4;
+
+    /**
+     * @brief First format version that stores key slots in the global header
+     */
+    constexpr uint16_t VARC_VERSION_KEY_SLOTS = (0 << 8) | 5;
 
     /**
      * @brief Archive format signature (magic bytes)
      */
     constexpr std::array<uint8_t, 4> VARC_SIGNATURE = {'V', 'A', 'R', 'C'};
 
+    /**
+     * @brief Entry index footer signature
+     */
+    constexpr std::array<uint8_t, 4> VARC_INDEX_SIGNATURE = {'V', 'I', 'D', 'X'};
+
     /**
      * @brief Size constants for fixed fields
      */
@@ -33,6 +48,14 @@ namespace VaultArchive {
     constexpr size_t IV_SIZE = 16;             // AES block size
     constexpr size_t CHECKSUM_SIZE = 32;       // SHA-256 hash size
     constexpr size_t ENTRY_HEADER_SIZE = 4 + 8 + 8 + 4 + 2; // Fixed part of entry header
+    constexpr size_t KEY_SLOT_COUNT = 8;       // Passwords an archive can have
+    constexpr size_t WRAPPED_KEY_SIZE = 12 + 32 + 16; // Data key sealed with AES-256-GCM (nonce, key, tag)
+    constexpr size_t KEY_SLOT_SIZE = 4 + SALT_SIZE + WRAPPED_KEY_SIZE; // Serialized key slot size
+    constexpr size_t GLOBAL_HEADER_SIZE_V3 = 64; // Global header size (format 0.3)
+    constexpr size_t GLOBAL_HEADER_SIZE_V4 = 80; // Global header size (format 0.4)
+    constexpr size_t GLOBAL_HEADER_SIZE = GLOBAL_HEADER_SIZE_V4 + KEY_SLOT_COUNT * KEY_SLOT_SIZE; // Format 0.5+
+    constexpr size_t INDEX_ENTRY_SIZE = 2 + 4 + 4 + 8 + 8 + 8 + 8 + 32 + 4; // Fixed part of index entry
+    constexpr size_t INDEX_FOOTER_SIZE = 4 + 4 + 8 + 8 + 32; // Index footer size
     constexpr size_t MAX_PATH_LENGTH = 65535;  // Maximum file path length
 
     /**
@@ -67,6 +90,35 @@ namespace VaultArchive {
         static uint32_t detect(const uint8_t* data, size_t size);
     };
 
+    /**
+     * @brief One password of an encrypted archive (format 0.5+)
+     *
+     * Entries are encrypted with a random data key. Each active slot holds
+     * that key sealed with a key-encryption key derived from one password,
+     * so a password is changed, added or removed by rewriting its slot.
+     */
+    struct KeySlot {
+        uint32_t iterations;                  // PBKDF2 iterations (0 = slot unused)
+        std::array<uint8_t, SALT_SIZE> salt;  // Salt for the key-encryption key
+        std::array<uint8_t, WRAPPED_KEY_SIZE> wrappedKey; // Data key sealed with the key-encryption key
+
+        /**
+         * @brief Default constructor (unused slot)
+         */
+        KeySlot();
+
+        /**
+         * @brief Check whether the slot holds a key
+         * @return true if active
+         */
+        bool isActive() const;
+
+        /**
+         * @brief Mark the slot unused and wipe its contents
+         */
+        void clear();
+    };
+
     /**
      * @brief Global archive header structure
      * This structure is written at the beginning of every .varc file
@@ -78,7 +130,10 @@ namespace VaultArchive {
         uint32_t fileCount;                   // Number of files in archive
         std::array<uint8_t, SALT_SIZE> salt; // Salt for key derivation (if encrypted)
         std::array<uint8_t, IV_SIZE> iv;      // Initialization vector (if encrypted)
-        uint64_t reserved;                    // Reserved for future use
+        uint32_t reserved;                    // Reserved for future use
+        uint64_t indexOffset;                 // Offset of the entry index (0.4+)
+        uint64_t indexSize;                   // Size of the entry index in bytes (0.4+)
+        std::array<KeySlot, KEY_SLOT_COUNT> keySlots; // Wrapped data keys (0.5+; none = key derived from salt)
 
         /**
          * @brief Default constructor
@@ -115,6 +170,30 @@ namespace VaultArchive {
          * @return true if compressed
          */
         bool isCompressed() const;
+
+        /**
+         * @brief Check if archive stores a trailing entry index
+         * @return true for format 0.4 and later
+         */
+        bool hasIndex() const;
+
+        /**
+         * @brief Check whether the header has room for key slots
+         * @return true for format 0.5 and later
+         */
+        bool hasKeySlots() const;
+
+        /**
+         * @brief Count the slots holding a key
+         * @return Number of passwords (0 = legacy key derivation from the salt)
+         */
+        size_t activeKeySlots() const;
+
+        /**
+         * @brief Get serialized header size for this header's version
+         * @return Size in bytes
+         */
+        size_t serializedSize() const;
     };
 
     /**
@@ -153,6 +232,194 @@ namespace VaultArchive {
         static size_t fixedSize();
     };
 
+    /**
+     * @brief Entry index record
+     * The entry index (table of contents) follows the last entry and holds
+     * one record per entry, so archives can be listed without touching
+     * entry payloads.
+     */
+    struct IndexEntry {
+        std::string path;             // Relative path within archive
+        uint32_t flags;               // Per-entry flags
+        uint32_t fileType;            // File type identifier
+        uint64_t originalSize;        // Original uncompressed file size
+        uint64_t compressedSize;      // Stored payload size
+        uint64_t dataOffset;          // Offset of the payload from archive start
+        uint64_t modificationTime;    // Modification time (seconds since epoch)
+        std::array<uint8_t, CHECKSUM_SIZE> checksum; // SHA-256 of original data
+        std::vector<uint8_t> extra;   // Extension records (tag, length, value)
+
+        /**
+         * @brief Default constructor
+         */
+        IndexEntry();
+
+        /**
+         * @brief Add or replace an extension record
+         * @param tag Record tag (see IndexExtraTag)
+         * @param value Record contents
+         */
+        void setExtra(uint16_t tag, const std::vector<uint8_t>& value);
+
+        /**
+         * @brief Look up an extension record
+         * @param tag Record tag (see IndexExtraTag)
+         * @param value Record contents (output)
+         * @return true if the record is present
+         */
+        bool findExtra(uint16_t tag, std::vector<uint8_t>& value) const;
+
+        /**
+         * @brief Append serialized record to byte vector
+         * @param data Output buffer
+         */
+        void serialize(std::vector<uint8_t>& data) const;
+
+        /**
+         * @brief Deserialize record from byte vector
+         * @param data Serialized index
+         * @param offset Starting offset in data
+         * @return Number of bytes consumed (0 on error)
+         */
+        size_t deserialize(const std::vector<uint8_t>& data, size_t offset);
+    };
+
+    /**
+     * @brief Tags of the extension records stored in IndexEntry::extra
+     * Each record is a 2-byte tag, a 4-byte length and the value. Readers
+     * skip records with unknown tags.
+     */
+    struct IndexExtraTag {
+        static constexpr uint16_t BLOCK_INDEX = 0x0001;  // BlockIndex of a block-split entry
+        static constexpr uint16_t CHUNK_LIST = 0x0002;   // ChunkList of a chunk-deduplicated entry
+        static constexpr uint16_t SOLID_BLOCK = 0x0003;  // SolidBlockRef of an entry stored in a solid block
+    };
+
+    /**
+     * @brief Block index of a block-split entry
+     * The entry's original data is cut into blockSize pieces (the last one
+     * may be shorter) that are encoded independently and stored back to
+     * back, so they can be compressed and decompressed in parallel.
+     */
+    struct BlockIndex {
+        uint32_t blockSize;                   // Original bytes per block
+        std::vector<uint32_t> storedSizes;    // Stored (encoded) size of each block
+
+        /**
+         * @brief Default constructor
+         */
+        BlockIndex();
+
+        /**
+         * @brief Serialize block index to byte vector
+         * @return Serialized block index
+         */
+        std::vector<uint8_t> serialize() const;
+
+        /**
+         * @brief Deserialize block index from byte vector
+         * @param data Serialized block index
+         * @return true if deserialization successful
+         */
+        bool deserialize(const std::vector<uint8_t>& data);
+    };
+
+    /**
+     * @brief Reference to one stored chunk of a chunk-deduplicated entry
+     */
+    struct ChunkRef {
+        uint64_t offset;                      // Offset of the stored chunk from archive start
+        uint32_t storedSize;                  // Stored (encoded) chunk size
+        uint32_t originalSize;                // Original chunk size
+        std::array<uint8_t, CHECKSUM_SIZE> checksum; // SHA-256 of the original chunk (chunk ID)
+    };
+
+    /**
+     * @brief Chunk list of a chunk-deduplicated entry
+     * The entry's original data is the concatenation of the chunks in
+     * order. Chunks are encoded independently and may be stored anywhere
+     * in the archive, so identical chunks are stored once and shared
+     * between and within entries.
+     */
+    struct ChunkList {
+        std::vector<ChunkRef> chunks;         // Chunks in file order
+
+        /**
+         * @brief Serialize chunk list to byte vector
+         * @return Serialized chunk list
+         */
+        std::vector<uint8_t> serialize() const;
+
+        /**
+         * @brief Deserialize chunk list from byte vector
+         * @param data Serialized chunk list
+         * @return true if deserialization successful
+         */
+        bool deserialize(const std::vector<uint8_t>& data);
+    };
+
+    /**
+     * @brief Location of an entry's data within a solid block
+     * Small files are concatenated and encoded together as one solid block,
+     * stored as the payload of the block's first entry. Each entry holds
+     * originalSize bytes starting at entryOffset of the decoded block.
+     */
+    struct SolidBlockRef {
+        uint64_t offset;                      // Offset of the stored block from archive start
+        uint32_t storedSize;                  // Stored (encoded) block size
+        uint32_t originalSize;                // Original block size
+        uint32_t entryOffset;                 // Offset of the entry's data in the original block
+
+        /**
+         * @brief Default constructor
+         */
+        SolidBlockRef();
+
+        /**
+         * @brief Serialize block reference to byte vector
+         * @return Serialized block reference
+         */
+        std::vector<uint8_t> serialize() const;
+
+        /**
+         * @brief Deserialize block reference from byte vector
+         * @param data Serialized block reference
+         * @return true if deserialization successful
+         */
+        bool deserialize(const std::vector<uint8_t>& data);
+    };
+
+    /**
+     * @brief Entry index footer
+     * Fixed-size trailer written directly after the entry index
+     */
+    struct IndexFooter {
+        std::array<uint8_t, 4> signature;    // Magic bytes: "VIDX"
+        uint32_t entryCount;                  // Number of index records
+        uint64_t indexOffset;                 // Offset of the entry index
+        uint64_t indexSize;                   // Size of the entry index in bytes
+        std::array<uint8_t, CHECKSUM_SIZE> checksum; // SHA-256 of the entry index
+
+        /**
+         * @brief Default constructor
+         */
+        IndexFooter();
+
+        /**
+         * @brief Serialize footer to byte vector
+         * @return Serialized footer data
+         */
+        std::vector<uint8_t> serialize() const;
+
+        /**
+         * @brief Deserialize footer from byte vector
+         * @param data Serialized footer data
+         * @param offset Starting offset in data
+         * @return true if deserialization successful
+         */
+        bool deserialize(const std::vector<uint8_t>& data, size_t offset = 0);
+    };
+
     /**
      * @brief Archive metadata structure
      * Optional metadata stored after global header
@@ -10,6 +10,9 @@
 #include "VarcEntry.hpp"
 #include "CryptoEngine.hpp"
 #include "CompressionEngine.hpp"
+#include "ThreadPool.hpp"
+#include "Chunker.hpp"
+#include "KeyAgent.hpp"
 #include <fstream>
 #include <sstream>
 #include <iomanip>
@@ -17,22 +20,312 @@
 #include <chrono>
 #include <algorithm>
 #include <cstring>
+#include <deque>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
 
 namespace VaultArchive {
 
+    namespace {
+
+        constexpr size_t STREAM_CHUNK_SIZE = 64 * 1024;  // File read size when streaming entries
+
+        // Parallel addFiles(): files up to this size are encoded in memory by workers
+        constexpr uint64_t PARALLEL_ENTRY_LIMIT = 64ULL * 1024 * 1024;
+
+        // Parallel addFiles(): cap on input bytes being encoded ahead of the writer
+        constexpr uint64_t PARALLEL_BUFFER_LIMIT = 256ULL * 1024 * 1024;
+
+        // Original bytes per block of a block-split entry
+        constexpr uint32_t ENTRY_BLOCK_SIZE = 1024 * 1024;
+
+        // Solid mode: files up to this size are packed into solid blocks
+        constexpr uint64_t SOLID_ENTRY_LIMIT = ENTRY_BLOCK_SIZE;
+
+        // Solid mode: a block is encoded once it holds this many original bytes
+        constexpr size_t SOLID_BLOCK_SIZE = 8 * 1024 * 1024;
+
+        // Encrypted entries are compressed first, then sealed unit by unit with AES-256-GCM
+        constexpr uint32_t ENCRYPTED_ENTRY_FLAGS =
+            EntryFlags::ENCRYPTED | EntryFlags::COMPRESSED_FIRST | EntryFlags::AUTHENTICATED;
+
+        /**
+         * @brief Get the codec new payloads are compressed with
+         * @param options Create options
+         * @return Codec id (CodecId::STORE when compression is off)
+         */
+        uint8_t entryCodec(const CreateOptions& options) {
+            return options.compress ? options.codec : static_cast<uint8_t>(CodecId::STORE);
+        }
+
+        /**
+         * @brief Get the entry flags describing a codec
+         * @param codec Codec id
+         * @return COMPRESSED plus the codec bits (none for CodecId::STORE)
+         */
+        uint32_t codecFlags(uint8_t codec) {
+            if (codec == CodecId::STORE) {
+                return 0;
+            }
+            return EntryFlags::COMPRESSED | (static_cast<uint32_t>(codec) << EntryFlags::CODEC_SHIFT);
+        }
+
+        /**
+         * @brief Decide how to encode a file
+         * @param options Create options
+         * @param path File path
+         * @param fileType Detected file type (only used by policies that match on type)
+         * @param size File size
+         * @return Archive-wide settings with the compression policy applied
+         *
+         * Files larger than SOLID_ENTRY_LIMIT are never packed solid.
+         */
+        PolicyDecision decideEncoding(const CreateOptions& options, const std::string& path, uint32_t fileType,
+            uint64_t size) {
+            PolicyDecision defaults;
+            defaults.codec = entryCodec(options);
+            defaults.level = options.compressionLevel;
+            defaults.solid = options.solid;
+
+            PolicyDecision decision = options.policy.decide(path, fileType, size, defaults);
+            decision.solid = decision.solid && size <= SOLID_ENTRY_LIMIT;
+            return decision;
+        }
+
+        /**
+         * @brief Detect the type of a file from its first bytes
+         * @param input File (the read position is restored)
+         * @return Detected file type
+         */
+        uint32_t detectFileType(std::istream& input) {
+            std::array<uint8_t, 256> head;
+            std::istream::pos_type position = input.tellg();
+            input.read(reinterpret_cast<char*>(head.data()), static_cast<std::streamsize>(head.size()));
+            size_t length = static_cast<size_t>(input.gcount());
+            input.clear();
+            input.seekg(position);
+            return FileType::detect(head.data(), length);
+        }
+
+        /**
+         * @brief Check whether sampling suggests a file is worth compressing
+         * @param input File being added (the read position is restored)
+         * @param size File size
+         * @return false if the stored payload would barely shrink
+         */
+        bool worthCompressing(std::istream& input, uint64_t size) {
+            // Files that fit in the sample are compressed whole and kept only if they shrink
+            if (size <= CompressionEngine::SAMPLE_WINDOWS * CompressionEngine::SAMPLE_WINDOW_SIZE) {
+                return true;
+            }
+
+            return CompressionEngine::estimateCompressionRatio(input, size) < CompressionEngine::INCOMPRESSIBLE_RATIO;
+        }
+
+        /**
+         * @brief Check whether sampling suggests a payload is worth compressing
+         * @param data Payload before encryption
+         * @return false if the stored payload would barely shrink
+         */
+        bool worthCompressing(const std::vector<uint8_t>& data) {
+            if (data.size() <= CompressionEngine::SAMPLE_WINDOWS * CompressionEngine::SAMPLE_WINDOW_SIZE) {
+                return true;
+            }
+            return CompressionEngine::estimateCompressionRatio(data) < CompressionEngine::INCOMPRESSIBLE_RATIO;
+        }
+
+        /**
+         * @brief Check whether a file is stored as independently encoded blocks
+         * @param size File size
+         * @param codec Codec chosen for the file
+         * @param encrypt File is encrypted
+         * @return true for files larger than one block that are compressed or encrypted
+         *
+         * Depends only on the file and the options, never on the thread count,
+         * so the same input always produces the same archive layout.
+         */
+        bool splitIntoBlocks(uint64_t size, uint8_t codec, bool encrypt) {
+            return size > ENTRY_BLOCK_SIZE && (codec != CodecId::STORE || encrypt);
+        }
+
+        /**
+         * @brief Independently encoded piece of a block-split or chunk-deduplicated entry
+         */
+        struct PayloadSegment {
+            uint64_t offset;                   // Offset of the stored segment from archive start
+            uint32_t storedSize;               // Stored size
+            uint32_t originalSize;             // Original size
+        };
+
+        /**
+         * @brief List the segments of a block-split or chunk-deduplicated entry
+         * @param entry Entry
+         * @return Segments in file order
+         */
+        std::vector<PayloadSegment> payloadSegments(const VarcEntry& entry) {
+            std::vector<PayloadSegment> segments;
+
+            if (entry.isChunked()) {
+                segments.reserve(entry.getChunkList().chunks.size());
+                for (const auto& chunk : entry.getChunkList().chunks) {
+                    segments.push_back({chunk.offset, chunk.storedSize, chunk.originalSize});
+                }
+                return segments;
+            }
+
+            // Blocks are stored back to back from the entry's data offset
+            const BlockIndex& blocks = entry.getBlockIndex();
+            uint64_t offset = entry.getOffset();
+            uint64_t remaining = entry.getOriginalSize();
+            segments.reserve(blocks.storedSizes.size());
+
+            for (uint32_t storedSize : blocks.storedSizes) {
+                uint32_t originalSize = static_cast<uint32_t>(std::min<uint64_t>(blocks.blockSize, remaining));
+                segments.push_back({offset, storedSize, originalSize});
+                offset += storedSize;
+                remaining -= originalSize;
+            }
+
+            return segments;
+        }
+
+        /**
+         * @brief Build the lookup key of a stored chunk
+         * @param checksum SHA-256 of the original chunk
+         * @param flags Flags of the entry the chunk was stored for
+         * @return Key string (chunks are only shared between entries with the same encoding)
+         */
+        std::string chunkKey(const std::array<uint8_t, CHECKSUM_SIZE>& checksum, uint32_t flags) {
+            std::string key(checksum.begin(), checksum.end());
+            key.push_back(static_cast<char>(flags & (EntryFlags::COMPRESSED | EntryFlags::ENCRYPTED)));
+            key.push_back(static_cast<char>((flags & EntryFlags::CODEC_MASK) >> EntryFlags::CODEC_SHIFT));
+            key.push_back(static_cast<char>(((flags & EntryFlags::COMPRESSED_FIRST) ? 1 : 0) |
+                ((flags & EntryFlags::AUTHENTICATED) ? 2 : 0)));
+            return key;
+        }
+
+        /**
+         * @brief Resolve a requested thread count
+         * @param threads Requested threads (0 = available cores)
+         * @return Thread count
+         */
+        unsigned int resolveThreads(unsigned int threads) {
+            return threads > 0 ? threads : ThreadPool::availableCores();
+        }
+
+        /**
+         * @brief Build the deduplication key of a payload
+         * @param checksum SHA-256 of the original data
+         * @param originalSize Original data size
+         * @return Key string
+         */
+        std::string payloadKey(const std::vector<uint8_t>& checksum, uint64_t originalSize) {
+            std::string key(checksum.begin(), checksum.end());
+            key.append(reinterpret_cast<const char*>(&originalSize), sizeof(originalSize));
+            return key;
+        }
+
+        /**
+         * @brief Calculate the SHA-256 of a file
+         * @param filepath Path to file
+         * @param checksum Hash (output)
+         * @return true if the whole file was read
+         */
+        bool hashFile(const std::string& filepath, std::vector<uint8_t>& checksum) {
+            std::ifstream input(filepath, std::ios::binary);
+            if (!input.is_open()) {
+                return false;
+            }
+
+            HashStream hash;
+            std::vector<char> buffer(STREAM_CHUNK_SIZE);
+            while (input.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || input.gcount() > 0) {
+                hash.update(reinterpret_cast<const uint8_t*>(buffer.data()), static_cast<size_t>(input.gcount()));
+            }
+            if (input.bad()) {
+                return false;
+            }
+
+            checksum = hash.finalize();
+            return true;
+        }
+
+        /**
+         * @brief Get the modification time of a file
+         * @param filepath Path to file
+         * @param time Modification time, to the second (output)
+         * @return true if the file's status could be read
+         */
+        bool fileModificationTime(const std::string& filepath, std::chrono::system_clock::time_point& time) {
+#ifndef _WIN32
+            struct stat status;
+            if (stat(filepath.c_str(), &status) != 0) {
+                return false;
+            }
+            time = std::chrono::system_clock::from_time_t(status.st_mtime);
+#else
+            // file_time_type has no conversion to system_clock before C++20
+            std::error_code ec;
+            auto fileTime = std::filesystem::last_write_time(filepath, ec);
+            if (ec) {
+                return false;
+            }
+            time = std::chrono::round<std::chrono::seconds>(std::chrono::system_clock::now() +
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                    fileTime - std::filesystem::file_time_type::clock::now()));
+#endif
+            return true;
+        }
+
+        /**
+         * @brief Expand the inputs of addFiles/updateFiles into regular files
+         * @param files File and directory paths
+         * @param options Creation options (includeHidden)
+         * @param allFiles Files found (output)
+         * @param fileSizes Size of each file found (output)
+         */
+        void collectFiles(const std::vector<std::string>& files, const CreateOptions& options,
+            std::vector<std::string>& allFiles, std::vector<uint64_t>& fileSizes) {
+            for (const auto& file : files) {
+                if (std::filesystem::is_directory(file)) {
+                    // Recursively collect files from directory
+                    for (const auto& entry : std::filesystem::recursive_directory_iterator(file)) {
+                        if (entry.is_regular_file()) {
+                            if (options.includeHidden || entry.path().filename().string()[0] != '.') {
+                                allFiles.push_back(entry.path().string());
+                                fileSizes.push_back(entry.file_size());
+                            }
+                        }
+                    }
+                } else if (std::filesystem::exists(file) && std::filesystem::is_regular_file(file)) {
+                    allFiles.push_back(file);
+                    fileSizes.push_back(std::filesystem::file_size(file));
+                }
+            }
+        }
+
+    } // namespace
+
     // ======================
     // Archive Implementation
     // ======================
 
     Archive::Archive()
-        : m_modified(false), m_loaded(false), m_crypto(std::make_unique<CryptoEngine>()),
-          m_compression(std::make_unique<CompressionEngine>()) {
+        : m_payloadIndexed(0), m_rewrite(false), m_copyRate(0), m_copiedBytes(0), m_modified(false), m_keysModified(false), m_loaded(false), m_crypto(std::make_unique<CryptoEngine>()),
+          m_compression(std::make_unique<CompressionEngine>()), m_keyCache(std::make_unique<KeyCache>()) {
     }
 
     Archive::Archive(const std::string& filepath)
-        : m_filepath(filepath), m_modified(false), m_loaded(false),
+        : m_filepath(filepath), m_payloadIndexed(0), m_rewrite(false), m_copyRate(0), m_copiedBytes(0), m_modified(false), m_keysModified(false), m_loaded(false),
           m_crypto(std::make_unique<CryptoEngine>()),
-          m_compression(std::make_unique<CompressionEngine>()) {
+          m_compression(std::make_unique<CompressionEngine>()), m_keyCache(std::make_unique<KeyCache>()) {
     }
 
     Archive::~Archive() {
@@ -45,6 +338,8 @@ namespace VaultArchive {
         m_filepath = filepath;
         m_header = GlobalHeader();
         m_entries.clear();
+        m_removed.clear();
+        m_rewrite = false;
         m_modified = true;
         m_loaded = true;
 
@@ -52,50 +347,51 @@ namespace VaultArchive {
     }
 
     bool Archive::open(const std::string& filepath, const std::string& password) {
+        return open(filepath, password, OpenOptions());
+    }
+
+    bool Archive::open(const std::string& filepath, const std::string& password, const OpenOptions& options) {
         close();
 
         m_filepath = filepath;
-        m_archiveData.clear();
+        m_openOptions = options;
 
-        // Read entire file into memory
-        std::ifstream file(filepath, std::ios::binary | std::ios::ate);
-        if (!file.is_open()) {
+        if (!m_file.open(filepath, options.memoryMap)) {
             m_errorMessage = "Cannot open archive file: " + filepath;
             return false;
         }
 
-        std::streamsize size = file.tellg();
-        file.seekg(0, std::ios::beg);
-
-        m_archiveData.resize(size);
-        if (!file.read(reinterpret_cast<char*>(m_archiveData.data()), size)) {
-            m_errorMessage = "Failed to read archive file";
-            return false;
-        }
-
-        file.close();
-
         // Parse archive
         if (!readArchive(password)) {
+            m_file.close();
             return false;
         }
 
         m_loaded = true;
+        m_removed.clear();
+        m_rewrite = false;
         m_modified = false;
+        m_keysModified = false;
 
         return true;
     }
 
     void Archive::close() {
-        if (m_modified) {
+        if (m_modified || m_keysModified) {
             save();
         }
 
         m_filepath.clear();
         m_entries.clear();
-        m_archiveData.clear();
+        invalidatePayloadIndex();
+        m_copiedChunks.clear();
+        m_output.reset();
+        m_file.close();
         m_header = GlobalHeader();
+        m_removed.clear();
+        m_rewrite = false;
         m_modified = false;
+        m_keysModified = false;
         m_loaded = false;
         m_errorMessage.clear();
     }
@@ -108,23 +404,120 @@ namespace VaultArchive {
             return false;
         }
 
-        if (!writeArchive()) {
+        // Only key slots changed: the header is rewritten in place
+        if (m_keysModified && !m_modified && !m_output && m_file.isOpen() && m_file.path() == outputPath) {
+            return writeHeader();
+        }
+
+        // Streamed entries have already been written to the pending output
+        if (m_output && m_output->targetPath() != outputPath) {
+            m_errorMessage = "Archive with streamed entries can only be saved to " + m_output->targetPath();
             return false;
         }
 
-        // Write to file
-        std::ofstream file(outputPath, std::ios::binary);
-        if (!file.is_open()) {
-            m_errorMessage = "Cannot create archive file: " + outputPath;
+        // Write into a temporary file that replaces the archive on commit, or
+        // onto the end of the archive itself when entries were only added
+        if (!m_output && !beginOutput(outputPath)) {
             return false;
         }
 
-        file.write(reinterpret_cast<const char*>(m_archiveData.data()), m_archiveData.size());
-        file.close();
+        // A rewrite was requested after appending began: settle the appended
+        // entries in place first, then rewrite the file from them
+        if (m_output->isAppending() && m_rewrite) {
+            if (!commitOutput(outputPath) || !beginOutput(outputPath)) {
+                return false;
+            }
+        }
+
+        return commitOutput(outputPath);
+    }
+
+    bool Archive::commitOutput(const std::string& outputPath) {
+        const bool appending = m_output->isAppending();
+
+        std::vector<IndexEntry> records;
+        if (!writeArchive(*m_output, records)) {
+            return false;
+        }
+
+        // Release the backing file before it is replaced
+        std::string backingPath = m_file.path();
+        m_file.close();
+
+        bool committed = m_output->commit();
+        m_output.reset();
+        m_copiedChunks.clear();
+
+        if (!committed) {
+            m_errorMessage = "Failed to write archive file: " + outputPath;
+
+            // Streamed payloads were discarded with the output
+            m_entries.erase(
+                std::remove_if(m_entries.begin(), m_entries.end(),
+                    [](const VarcEntry& e) { return e.isStaged(); }),
+                m_entries.end()
+            );
+            invalidatePayloadIndex();
+
+            if (!backingPath.empty()) {
+                m_file.open(backingPath, m_openOptions.memoryMap);
+            }
+            return false;
+        }
+
+        // Entries now reference their payloads in the written file
+        if (!m_file.open(outputPath, m_openOptions.memoryMap)) {
+            m_errorMessage = "Cannot reopen archive file: " + outputPath;
+            return false;
+        }
+
+        for (size_t i = 0; i < m_entries.size(); ++i) {
+            m_entries[i].setOffset(records[i].dataOffset);
+            m_entries[i].setCompressedSize(records[i].compressedSize);
+            if (m_entries[i].isChunked()) {
+                // Chunks may have been rearranged by the copy
+                std::vector<uint8_t> chunkData;
+                ChunkList chunks;
+                if (records[i].findExtra(IndexExtraTag::CHUNK_LIST, chunkData) && chunks.deserialize(chunkData)) {
+                    m_entries[i].setChunkList(chunks);
+                }
+            }
+            if (m_entries[i].isSolid()) {
+                std::vector<uint8_t> blockData;
+                SolidBlockRef block;
+                if (records[i].findExtra(IndexExtraTag::SOLID_BLOCK, blockData) && block.deserialize(blockData)) {
+                    m_entries[i].setSolidBlock(block);
+                }
+            }
+            m_entries[i].setStaged(false);
+            m_entries[i].clearData();
+        }
 
+        // Stored chunk locations refer to the old file
+        invalidatePayloadIndex();
+        m_removed.clear();
+
+        if (!appending) {
+            m_rewrite = false;
+        }
         m_filepath = outputPath;
         m_modified = false;
+        m_keysModified = false;
+
+        return true;
+    }
+
+    bool Archive::writeHeader() {
+        std::vector<uint8_t> headerData = m_header.serialize();
+
+        OutputFile output;
+        if (!output.append(m_file.path()) || !output.writeAt(0, headerData.data(), headerData.size()) ||
+            !output.commit()) {
+            m_errorMessage = "Failed to write archive header: " + m_file.path();
+            return false;
+        }
 
+        m_keysModified = false;
         return true;
     }
 
@@ -133,7 +526,7 @@ namespace VaultArchive {
     }
 
     bool Archive::isModified() const {
-        return m_modified;
+        return m_modified || m_keysModified;
     }
 
     const std::string& Archive::getLastError() const {
@@ -146,8 +539,17 @@ namespace VaultArchive {
             return false;
         }
 
-        VarcEntry entry = createEntryFromPath(filepath);
-        return processEntry(entry, options);
+        // Blocks or chunks of a large file are encoded on a pool of their own
+        std::error_code ec;
+        unsigned int threads = resolveThreads(options.threads);
+        uint64_t size = std::filesystem::file_size(filepath, ec);
+        if (threads > 1 && !ec &&
+            (size > ENTRY_BLOCK_SIZE || (options.chunkDedup && size > Chunker::MAX_SIZE))) {
+            ThreadPool pool(threads);
+            return addStreamedFile(filepath, options, &pool);
+        }
+
+        return addStreamedFile(filepath, options, nullptr);
     }
 
     ArchiveResult Archive::addFiles(const std::vector<std::string>& files, const CreateOptions& options) {
@@ -156,43 +558,335 @@ namespace VaultArchive {
         result.filesProcessed = 0;
         result.bytesProcessed = 0;
 
-        uint64_t totalBytes = 0;
         std::vector<std::string> allFiles;
+        std::vector<uint64_t> fileSizes;
 
         // Collect all files (expanding directories)
-        for (const auto& file : files) {
-            if (std::filesystem::is_directory(file)) {
-                // Recursively collect files from directory
-                for (const auto& entry : std::filesystem::recursive_directory_iterator(file)) {
-                    if (entry.is_regular_file()) {
-                        if (options.includeHidden || entry.path().filename().string()[0] != '.') {
-                            allFiles.push_back(entry.path().string());
-                            totalBytes += entry.file_size();
+        collectFiles(files, options, allFiles, fileSizes);
+
+        uint64_t totalBytes = 0;
+        for (uint64_t size : fileSizes) {
+            totalBytes += size;
+        }
+
+        uint64_t processedBytes = 0;
+        size_t processedFiles = 0;
+        const size_t firstEntry = m_entries.size();
+
+        auto finishFile = [&](size_t i, bool added) {
+            if (added) {
+                result.filesProcessed++;
+                result.bytesProcessed += fileSizes[i];
+            } else {
+                result.success = false;
+            }
+            processedBytes += fileSizes[i];
+
+            invokeProgress(++processedFiles, allFiles.size(), processedBytes, totalBytes, allFiles[i]);
+        };
+
+        // Small files the options or the policy pack solid go first, in solid
+        // blocks the pool encodes; the other files follow
+        if ((options.solid || options.policy.usesSolid()) && isOpen()) {
+            std::vector<std::string> solidFiles;
+            std::vector<uint64_t> solidSizes;
+            std::vector<size_t> solidIndex;
+            std::vector<std::string> otherFiles;
+            std::vector<uint64_t> otherSizes;
+            std::vector<size_t> otherIndex;
+
+            for (size_t i = 0; i < allFiles.size(); ++i) {
+                uint32_t fileType = FileType::UNKNOWN;
+                if (fileSizes[i] <= SOLID_ENTRY_LIMIT && options.policy.usesFileTypes()) {
+                    std::ifstream input(allFiles[i], std::ios::binary);
+                    fileType = detectFileType(input);
+                }
+
+                if (decideEncoding(options, allFiles[i], fileType, fileSizes[i]).solid) {
+                    solidFiles.push_back(allFiles[i]);
+                    solidSizes.push_back(fileSizes[i]);
+                    solidIndex.push_back(i);
+                } else {
+                    otherFiles.push_back(allFiles[i]);
+                    otherSizes.push_back(fileSizes[i]);
+                    otherIndex.push_back(i);
+                }
+            }
+
+            std::unique_ptr<ThreadPool> pool;
+            unsigned int threads = resolveThreads(options.threads);
+            if (threads > 1 && !solidFiles.empty()) {
+                pool = std::make_unique<ThreadPool>(threads);
+            }
+            addSolidFiles(solidFiles, solidSizes, options, pool.get(),
+                [&](size_t i, bool added) { finishFile(solidIndex[i], added); });
+            pool.reset();
+
+            addCollectedFiles(otherFiles, otherSizes, options,
+                [&](size_t i, bool added) { finishFile(otherIndex[i], added); });
+        } else {
+            addCollectedFiles(allFiles, fileSizes, options, finishFile);
+        }
+
+        // Files and bytes per policy rule, for the entries just added
+        for (size_t i = firstEntry; i < m_entries.size(); ++i) {
+            const VarcEntry& entry = m_entries[i];
+            if (entry.isDirectory()) {
+                continue;
+            }
+
+            CompressionStats& stats = result.ruleStats[decideEncoding(options, entry.getPath(),
+                entry.getFileType(), entry.getOriginalSize()).rule];
+            stats.filesProcessed++;
+            stats.totalOriginalSize += entry.getOriginalSize();
+            stats.totalCompressedSize += entry.getCompressedSize();
+        }
+
+        return result;
+    }
+
+    void Archive::addCollectedFiles(
+        const std::vector<std::string>& allFiles,
+        const std::vector<uint64_t>& fileSizes,
+        const CreateOptions& options,
+        const std::function<void(size_t, bool)>& finishFile
+    ) {
+        unsigned int threads = resolveThreads(options.threads);
+
+        if (threads <= 1 || allFiles.size() <= 1 || !isOpen()) {
+            for (size_t i = 0; i < allFiles.size(); ++i) {
+                finishFile(i, addFile(allFiles[i], options));
+            }
+            return;
+        }
+
+        // Chunk lookups depend on every earlier file, so files are added in
+        // turn and the pool encodes the chunks of each
+        if (options.chunkDedup) {
+            ThreadPool pool(threads);
+            for (size_t i = 0; i < allFiles.size(); ++i) {
+                finishFile(i, addStreamedFile(allFiles[i], options, &pool));
+            }
+            return;
+        }
+
+        // Shared state is set up before the workers start
+        if (options.encrypt && !options.password.empty()) {
+            initializeEncryption(options.password);
+        }
+        if (!m_output && !beginOutput(m_filepath)) {
+            for (size_t i = 0; i < allFiles.size(); ++i) {
+                finishFile(i, false);
+            }
+            return;
+        }
+
+        struct EncodedFile {
+            VarcEntry entry;
+            std::vector<uint8_t> payload;
+            std::vector<uint8_t> checksum;     // Content hash taken before encoding (dedup only)
+            bool duplicate;                    // Not encoded: an earlier file has the same contents
+            bool success;
+            std::string error;
+        };
+
+        // Dedup: contents claimed so far (key -> 0 for stored entries, else
+        // input position + 1). Only the lowest claimant encodes the contents.
+        std::unordered_map<std::string, size_t> claims;
+        std::mutex claimsMutex;
+        if (options.deduplicate) {
+            updatePayloadIndex();
+            for (const auto& stored : m_payloadIndex) {
+                claims.emplace(stored.first, 0);
+            }
+        }
+
+        // Workers encode small files into memory; large files are streamed
+        // on this thread when their turn comes, with their blocks encoded
+        // by the same workers. Entries are appended in input order so the
+        // archive layout does not depend on scheduling.
+        ThreadPool pool(threads);
+        std::deque<std::future<EncodedFile>> window;
+        const size_t maxInFlight = pool.size() * 4;
+        uint64_t bufferedBytes = 0;
+        size_t submitted = 0;
+
+        for (size_t i = 0; i < allFiles.size(); ++i) {
+            while (submitted < allFiles.size() && window.size() < maxInFlight &&
+                   (window.empty() || bufferedBytes + fileSizes[submitted] <= PARALLEL_BUFFER_LIMIT)) {
+                if (fileSizes[submitted] > PARALLEL_ENTRY_LIMIT) {
+                    window.emplace_back();
+                } else {
+                    const std::string& path = allFiles[submitted];
+                    uint64_t size = fileSizes[submitted];
+                    size_t claimant = submitted + 1;
+                    window.push_back(pool.submit([this, &options, &path, size, claimant, &claims, &claimsMutex]() {
+                        EncodedFile encoded;
+                        encoded.entry = createEntryFromPath(path);
+                        encoded.duplicate = false;
+
+                        if (options.deduplicate) {
+                            if (!hashFile(path, encoded.checksum)) {
+                                encoded.success = false;
+                                encoded.error = "Cannot read file: " + path;
+                                return encoded;
+                            }
+
+                            std::lock_guard<std::mutex> lock(claimsMutex);
+                            auto claim = claims.emplace(payloadKey(encoded.checksum, encoded.entry.getOriginalSize()), claimant);
+                            if (!claim.second && claim.first->second < claimant) {
+                                encoded.duplicate = true;
+                                encoded.success = true;
+                                return encoded;
+                            }
+                            claim.first->second = claimant;
                         }
-                    }
+
+                        encoded.payload.reserve(static_cast<size_t>(size));
+
+                        std::ifstream input(path, std::ios::binary);
+                        if (!input.is_open()) {
+                            encoded.success = false;
+                            encoded.error = "Cannot open file: " + path;
+                            return encoded;
+                        }
+
+                        encoded.success = encodeFile(input, path, encoded.entry, options,
+                            [&encoded](const uint8_t* data, size_t length) {
+                                encoded.payload.insert(encoded.payload.end(), data, data + length);
+                            }, encoded.error);
+                        return encoded;
+                    }));
+                    bufferedBytes += size;
+                }
+                ++submitted;
+            }
+
+            std::future<EncodedFile> pending = std::move(window.front());
+            window.pop_front();
+
+            bool added = false;
+            if (pending.valid()) {
+                EncodedFile encoded = pending.get();
+                bufferedBytes -= fileSizes[i];
+
+                if (!encoded.success) {
+                    m_errorMessage = encoded.error;
+                } else if (options.deduplicate && addSharedEntry(encoded.entry, encoded.checksum)) {
+                    added = true;
+                } else if (encoded.duplicate) {
+                    // The file it duplicates was not added after all
+                    added = addStreamedFile(allFiles[i], options, &pool);
+                } else {
+                    added = appendEntry(encoded.entry, encoded.payload);
                 }
-            } else if (std::filesystem::exists(file) && std::filesystem::is_regular_file(file)) {
-                allFiles.push_back(file);
-                totalBytes += std::filesystem::file_size(file);
+            } else {
+                added = addStreamedFile(allFiles[i], options, &pool);
             }
+
+            finishFile(i, added);
         }
+    }
 
-        uint64_t processedBytes = 0;
+    ArchiveResult Archive::updateFiles(const std::vector<std::string>& files, const CreateOptions& options) {
+        if (!isOpen()) {
+            ArchiveResult result;
+            m_errorMessage = "Archive not open";
+            result.message = m_errorMessage;
+            return result;
+        }
 
+        std::vector<std::string> allFiles;
+        std::vector<uint64_t> fileSizes;
+        collectFiles(files, options, allFiles, fileSizes);
+
+        std::unordered_map<std::string, size_t> stored;
+        stored.reserve(m_entries.size());
+        for (size_t i = 0; i < m_entries.size(); ++i) {
+            if (!m_entries[i].isDirectory()) {
+                stored.emplace(m_entries[i].getPath(), i);
+            }
+        }
+
+        // Compare size and modification time against the entry table
+        std::vector<bool> changed(allFiles.size(), true);
+        std::vector<size_t> candidates;
         for (size_t i = 0; i < allFiles.size(); ++i) {
-            const auto& file = allFiles[i];
+            auto it = stored.find(allFiles[i]);
+            if (it == stored.end()) {
+                continue;
+            }
 
-            if (addFile(file, options)) {
-                result.filesProcessed++;
-                result.bytesProcessed += std::filesystem::file_size(file);
+            const VarcEntry& entry = m_entries[it->second];
+            std::chrono::system_clock::time_point modified;
+            if (!fileModificationTime(allFiles[i], modified) || entry.getOriginalSize() != fileSizes[i] ||
+                std::chrono::system_clock::to_time_t(entry.getModificationTime()) !=
+                    std::chrono::system_clock::to_time_t(modified)) {
+                continue;
+            }
+
+            if (options.compareChecksums) {
+                candidates.push_back(i);
             } else {
-                result.success = false;
+                changed[i] = false;
+            }
+        }
+
+        // Hash files that look unchanged, in input order
+        if (!candidates.empty()) {
+            auto matches = [&allFiles](size_t i, const std::vector<uint8_t>& expected) {
+                std::vector<uint8_t> checksum;
+                return hashFile(allFiles[i], checksum) && checksum == expected;
+            };
+
+            std::unique_ptr<ThreadPool> pool;
+            unsigned int threads = resolveThreads(options.threads);
+            if (threads > 1 && candidates.size() > 1) {
+                pool = std::make_unique<ThreadPool>(threads);
             }
-            processedBytes += std::filesystem::file_size(file);
 
-            invokeProgress(i + 1, allFiles.size(), processedBytes, totalBytes, file);
+            std::deque<std::pair<size_t, std::future<bool>>> window;
+            for (size_t i : candidates) {
+                const std::vector<uint8_t>& expected = m_entries[stored[allFiles[i]]].getChecksum();
+                if (!pool) {
+                    changed[i] = !matches(i, expected);
+                    continue;
+                }
+
+                if (window.size() >= pool->size() * 4) {
+                    changed[window.front().first] = !window.front().second.get();
+                    window.pop_front();
+                }
+
+                window.emplace_back(i, pool->submit([&matches, &expected, i]() { return matches(i, expected); }));
+            }
+
+            while (!window.empty()) {
+                changed[window.front().first] = !window.front().second.get();
+                window.pop_front();
+            }
+        }
+
+        // Changed files replace their entries; unchanged entries keep their payloads
+        std::vector<std::string> updated;
+        std::set<std::string> replaced;
+        for (size_t i = 0; i < allFiles.size(); ++i) {
+            if (changed[i]) {
+                updated.push_back(allFiles[i]);
+                if (stored.count(allFiles[i])) {
+                    replaced.insert(allFiles[i]);
+                }
+            }
         }
 
+        if (!replaced.empty()) {
+            eraseEntries([&replaced](const VarcEntry& e) { return !e.isDirectory() && replaced.count(e.getPath()); });
+        }
+
+        uint64_t unchanged = allFiles.size() - updated.size();
+
+        ArchiveResult result = addFiles(updated, options);
+        result.message = std::to_string(unchanged) + " unchanged";
         return result;
     }
 
@@ -255,7 +949,9 @@ namespace VaultArchive {
             return false;
         }
 
+        retireEntry(*it);
         m_entries.erase(it);
+        invalidatePayloadIndex();
         m_modified = true;
         return true;
     }
@@ -288,55 +984,130 @@ namespace VaultArchive {
             return i == str.size() && j == pattern.size();
         };
 
-        m_entries.erase(
-            std::remove_if(m_entries.begin(), m_entries.end(),
-                [&matchesPattern, &pattern, &count](const VarcEntry& e) {
-                    if (matchesPattern(e.getPath(), pattern)) {
-                        ++count;
-                        return true;
-                    }
-                    return false;
-                }),
-            m_entries.end()
-        );
-
-        if (count > 0) {
-            m_modified = true;
-        }
-
-        return count;
+        return eraseEntries([&matchesPattern, &pattern](const VarcEntry& e) {
+            return matchesPattern(e.getPath(), pattern);
+        });
     }
 
     void Archive::clearEntries() {
+        // An empty archive is cheaper to rewrite than to tombstone
         m_entries.clear();
+        m_removed.clear();
+        invalidatePayloadIndex();
+        m_rewrite = true;
         m_modified = true;
     }
 
-    ArchiveResult Archive::extractAll(
-        const std::string& outputDir,
-        const std::string& password,
-        const ExtractOptions& options
-    ) {
-        ArchiveResult result;
-        result.success = true;
-        result.filesProcessed = 0;
-        result.bytesProcessed = 0;
-
-        // Create output directory
-        std::filesystem::create_directories(outputDir);
+    uint64_t Archive::eraseEntries(const std::function<bool(const VarcEntry&)>& matches) {
+        auto removed = std::stable_partition(m_entries.begin(), m_entries.end(),
+            [&matches](const VarcEntry& e) { return !matches(e); });
+        uint64_t count = static_cast<uint64_t>(std::distance(removed, m_entries.end()));
 
-        // Initialize crypto if needed
-        if (m_header.isEncrypted()) {
-            if (password.empty()) {
-                m_errorMessage = "Password required for encrypted archive";
-                result.success = false;
-                return result;
+        if (count > 0) {
+            for (auto it = removed; it != m_entries.end(); ++it) {
+                retireEntry(*it);
             }
-            m_crypto->initializeFromPassword(password, std::vector<uint8_t>(m_header.salt.begin(), m_header.salt.end()));
+            m_entries.erase(removed, m_entries.end());
+            invalidatePayloadIndex();
+            m_modified = true;
         }
 
-        for (size_t i = 0; i < m_entries.size(); ++i) {
-            const auto& entry = m_entries[i];
+        return count;
+    }
+
+    void Archive::retireEntry(VarcEntry& entry) {
+        // Entries stored in the open file get a tombstone on save
+        if (!entry.isStaged() && !entry.isLoaded() && m_file.isOpen()) {
+            m_removed.push_back(std::move(entry));
+        }
+    }
+
+    bool Archive::compact(const CompactOptions& options) {
+        if (!isOpen() || m_filepath.empty()) {
+            m_errorMessage = "Archive not open";
+            return false;
+        }
+
+        // Pending changes are settled by save() before the rewrite
+        m_rewrite = true;
+        m_copyRate = options.bytesPerSecond;
+        m_copiedBytes = 0;
+        m_copyStart = std::chrono::steady_clock::now();
+
+        bool saved = save();
+        m_copyRate = 0;
+
+        return saved;
+    }
+
+    uint64_t Archive::getUnusedSize() const {
+        if (!m_file.isOpen() || !m_header.hasIndex()) {
+            return 0;
+        }
+
+        uint64_t used = m_header.serializedSize() + m_header.indexSize + INDEX_FOOTER_SIZE;
+        std::set<uint64_t> payloads;
+        std::set<uint64_t> chunks;
+
+        for (const auto& entry : m_entries) {
+            // Shared payloads have a single entry header
+            if (entry.isStaged() || entry.isLoaded() || !payloads.insert(entry.getOffset()).second) {
+                continue;
+            }
+
+            used += EntryHeader::fixedSize() + entry.getPath().length() + CHECKSUM_SIZE;
+
+            if (entry.isChunked()) {
+                for (const auto& chunk : entry.getChunkList().chunks) {
+                    if (chunks.insert(chunk.offset).second) {
+                        used += chunk.storedSize;
+                    }
+                }
+            } else if (entry.isSolid()) {
+                if (chunks.insert(entry.getSolidBlock().offset).second) {
+                    used += entry.getSolidBlock().storedSize;
+                }
+            } else {
+                used += entry.getCompressedSize();
+            }
+        }
+
+        return m_file.size() > used ? m_file.size() - used : 0;
+    }
+
+    ArchiveResult Archive::extractAll(
+        const std::string& outputDir,
+        const std::string& password,
+        const ExtractOptions& options
+    ) {
+        ArchiveResult result;
+        result.success = true;
+        result.filesProcessed = 0;
+        result.bytesProcessed = 0;
+
+        // Create output directory
+        std::filesystem::create_directories(outputDir);
+
+        // Initialize crypto if needed
+        if (m_header.isEncrypted()) {
+            if (password.empty()) {
+                m_errorMessage = "Password required for encrypted archive";
+                result.success = false;
+                return result;
+            }
+            loadEncryptionKey(password);
+        }
+
+        // Blocks and chunks of split entries are decoded on a shared pool
+        std::unique_ptr<ThreadPool> pool;
+        unsigned int threads = resolveThreads(options.threads);
+        if (threads > 1 && std::any_of(m_entries.begin(), m_entries.end(),
+                [](const VarcEntry& entry) { return entry.isBlocked() || entry.isChunked(); })) {
+            pool = std::make_unique<ThreadPool>(threads);
+        }
+
+        for (size_t i = 0; i < m_entries.size(); ++i) {
+            const auto& entry = m_entries[i];
 
             if (entry.isDirectory()) {
                 std::string dirPath = outputDir + "/" + entry.getPath();
@@ -364,7 +1135,7 @@ namespace VaultArchive {
                 std::filesystem::create_directories(parentDir);
             }
 
-            if (extractFile(entry.getPath(), outputPath, password)) {
+            if (extractEntry(entry, outputPath, pool.get())) {
                 result.filesProcessed++;
                 result.bytesProcessed += entry.getOriginalSize();
 
@@ -405,12 +1176,24 @@ namespace VaultArchive {
             return false;
         }
 
-        std::vector<uint8_t> data = entry->getData();
-        if (data.empty() && entry->getOriginalSize() > 0) {
-            m_errorMessage = "Empty entry data: " + path;
-            return false;
+        if (entry->isEncrypted() && !m_crypto->isInitialized()) {
+            if (password.empty()) {
+                m_errorMessage = "Password required for encrypted archive";
+                return false;
+            }
+            loadEncryptionKey(password);
         }
 
+        unsigned int threads = ThreadPool::availableCores();
+        if (threads > 1 && (entry->isBlocked() || entry->isChunked())) {
+            ThreadPool pool(threads);
+            return extractEntry(*entry, outputPath, &pool);
+        }
+
+        return extractEntry(*entry, outputPath, nullptr);
+    }
+
+    bool Archive::extractEntry(const VarcEntry& entry, const std::string& outputPath, ThreadPool* pool) {
         // Create parent directories
         std::filesystem::path parentDir = std::filesystem::path(outputPath).parent_path();
         if (!parentDir.empty()) {
@@ -424,11 +1207,24 @@ namespace VaultArchive {
             return false;
         }
 
-        if (!data.empty()) {
-            file.write(reinterpret_cast<const char*>(data.data()), data.size());
-        }
+        bool decoded = decodeEntry(entry, [&file](const uint8_t* data, size_t length) {
+            if (!file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(length))) {
+                throw std::runtime_error("Failed to write output file");
+            }
+        }, pool);
         file.close();
 
+        if (!decoded || file.fail()) {
+            if (decoded) {
+                m_errorMessage = "Failed to write output file: " + outputPath;
+            }
+
+            // Do not leave a truncated or corrupt file behind
+            std::error_code ec;
+            std::filesystem::remove(outputPath, ec);
+            return false;
+        }
+
         return true;
     }
 
@@ -455,9 +1251,122 @@ namespace VaultArchive {
             return {};
         }
 
-        // Entry data should already be loaded during readArchive
-        // For now, return the data from the entry
-        return entry->getData();
+        return readEntryPayload(*entry);
+    }
+
+    bool Archive::readRange(
+        const std::string& path,
+        uint64_t offset,
+        uint64_t length,
+        std::vector<uint8_t>& data,
+        const std::string& password
+    ) {
+        data.clear();
+
+        const VarcEntry* entry = findEntry(path);
+        if (!entry) {
+            m_errorMessage = "Entry not found: " + path;
+            return false;
+        }
+
+        if (entry->isEncrypted() && !m_crypto->isInitialized()) {
+            if (password.empty()) {
+                m_errorMessage = "Password required for encrypted archive";
+                return false;
+            }
+            loadEncryptionKey(password);
+        }
+
+        const uint64_t originalSize = entry->getOriginalSize();
+        if (offset >= originalSize || length == 0) {
+            return true;
+        }
+        length = std::min(length, originalSize - offset);
+        data.reserve(static_cast<size_t>(length));
+
+        // Slice the range out of the decoded solid block
+        if (entry->isSolid()) {
+            try {
+                const std::vector<uint8_t>& block = loadSolidBlock(*entry);
+                auto begin = block.begin() + static_cast<std::ptrdiff_t>(entry->getSolidBlock().entryOffset + offset);
+                data.assign(begin, begin + static_cast<std::ptrdiff_t>(length));
+            } catch (const std::exception& e) {
+                m_errorMessage = "Failed to read " + path + ": " + e.what();
+                return false;
+            }
+            return true;
+        }
+
+        // Stored as-is: read the range straight from the payload
+        if (!entry->isCompressed() && !entry->isEncrypted()) {
+            if (entry->isLoaded()) {
+                auto begin = entry->getData().begin() + static_cast<std::ptrdiff_t>(offset);
+                data.assign(begin, begin + static_cast<std::ptrdiff_t>(length));
+                return true;
+            }
+
+            data.resize(static_cast<size_t>(length));
+            if (!readStoredData(*entry, offset, data.data(), data.size())) {
+                data.clear();
+                m_errorMessage = "Failed to read entry data: " + path;
+                return false;
+            }
+            return true;
+        }
+
+        if (!entry->isBlocked() && !entry->isChunked()) {
+            uint64_t position = 0;
+            bool decoded = decodeEntry(*entry, [&](const uint8_t* chunk, size_t chunkLength) {
+                uint64_t begin = std::max(offset, position);
+                uint64_t end = std::min(offset + length, position + chunkLength);
+                if (begin < end) {
+                    data.insert(data.end(), chunk + (begin - position), chunk + (end - position));
+                }
+                position += chunkLength;
+            });
+            if (!decoded) {
+                data.clear();
+            }
+            return decoded;
+        }
+
+        // Decode only the blocks or chunks that overlap the range
+        uint64_t segmentStart = 0;
+
+        try {
+            const std::vector<PayloadSegment> segments = payloadSegments(*entry);
+            std::unique_ptr<SegmentCipher> stream = segments.empty() ? nullptr : openEntryStream(*entry);
+
+            for (uint64_t index = 0; index < segments.size(); ++index) {
+                const PayloadSegment& segment = segments[index];
+                uint64_t segmentEnd = segmentStart + segment.originalSize;
+                if (segmentStart >= offset + length) {
+                    break;
+                }
+
+                if (segmentEnd > offset) {
+                    std::vector<uint8_t> stored(segment.storedSize);
+                    if (!readArchiveData(entry->isStaged(), segment.offset, stored.data(), stored.size())) {
+                        throw std::runtime_error("Failed to read entry data");
+                    }
+
+                    std::vector<uint8_t> plain = decodeBlock(*entry, std::move(stored), segment.originalSize,
+                        stream.get(), index, index + 1 == segments.size());
+
+                    uint64_t begin = std::max(offset, segmentStart) - segmentStart;
+                    uint64_t end = std::min(offset + length, segmentEnd) - segmentStart;
+                    data.insert(data.end(), plain.begin() + begin, plain.begin() + end);
+                }
+
+                segmentStart = segmentEnd;
+            }
+        } catch (const std::exception& e) {
+            data.clear();
+            m_errorMessage = "Failed to read " + path + ": " + e.what();
+            return false;
+        }
+
+        return true;
     }
 
     uint64_t Archive::getEntryCount() const {
@@ -474,7 +1383,13 @@ namespace VaultArchive {
 
     uint64_t Archive::getTotalCompressedSize() const {
         uint64_t total = 0;
+        std::set<std::pair<bool, uint64_t>> payloads;  // (staged, offset) of payloads counted so far
+
         for (const auto& entry : m_entries) {
+            // Deduplicated entries share one stored payload
+            if (!entry.isLoaded() && !payloads.emplace(entry.isStaged(), entry.getOffset()).second) {
+                continue;
+            }
             total += entry.getCompressedSize();
         }
         return total;
@@ -554,7 +1469,7 @@ namespace VaultArchive {
                 m_errorMessage = "Password required for encrypted archive";
                 return false;
             }
-            m_crypto->initializeFromPassword(password, std::vector<uint8_t>(m_header.salt.begin(), m_header.salt.end()));
+            loadEncryptionKey(password);
         }
 
         for (const auto& entry : m_entries) {
@@ -600,7 +1515,9 @@ namespace VaultArchive {
         for (const auto& entry : m_entries) {
             report << entry.getPath() << " - " << entry.getSizeString();
             if (entry.isCompressed()) {
-                report << " -> " << entry.getCompressedSizeString();
+                const Codec* codec = CodecRegistry::find(entry.getCodec());
+                report << " -> " << entry.getCompressedSizeString()
+                       << " (" << (codec ? codec->name() : "codec " + std::to_string(entry.getCodec())) << ")";
             }
             report << "\n";
         }
@@ -695,35 +1612,58 @@ namespace VaultArchive {
         return output.str();
     }
 
+    std::string Archive::getSummary() const {
+        std::ostringstream output;
+
+        output << "Archive: " << m_filepath << "\n";
+        output << "Format: " << ((m_header.version >> 8) & 0xFF) << "." << (m_header.version & 0xFF) << "\n";
+        output << "Files: " << m_entries.size() << "\n";
+        output << "Original size: " << getTotalOriginalSizeString() << "\n";
+        output << "Stored size: " << getTotalCompressedSizeString() << "\n";
+        output << "Encrypted: " << (m_header.isEncrypted() ? "Yes" : "No") << "\n";
+        if (m_header.isEncrypted() && m_header.activeKeySlots() > 0) {
+            output << "Passwords: " << m_header.activeKeySlots() << " of " << KEY_SLOT_COUNT << " key slots\n";
+        }
+        output << "Compressed: " << (m_header.isCompressed() ? "Yes" : "No") << "\n";
+
+        if (m_header.hasIndex()) {
+            output << "Index: " << formatSize(m_header.indexSize)
+                   << " at offset " << m_header.indexOffset << "\n";
+            output << "Unused space: " << formatSize(getUnusedSize()) << "\n";
+        }
+
+        return output.str();
+    }
+
     void Archive::setProgressCallback(ProgressCallback callback) {
         m_progressCallback = callback;
     }
 
+    void Archive::setKeyAgent(const std::string& socketPath) {
+        m_agentSocket = socketPath;
+    }
+
     bool Archive::lock(const std::string& password) {
         if (password.empty()) {
             m_errorMessage = "Password cannot be empty";
             return false;
         }
 
-        // Generate salt and IV
-        std::vector<uint8_t> salt = CryptoEngine::generateSalt();
-        std::vector<uint8_t> iv = CryptoEngine::generateIV();
-
-        // Copy to header
-        std::memcpy(m_header.salt.data(), salt.data(), salt.size());
-        std::memcpy(m_header.iv.data(), iv.data(), iv.size());
-
-        // Set encrypted flag
-        m_header.flags |= ArchiveFlags::ENCRYPTED;
+        if (m_header.isEncrypted()) {
+            m_errorMessage = "Archive is already encrypted";
+            return false;
+        }
 
-        // Initialize crypto
-        m_crypto->initializeFromPassword(password, salt);
+        // New data key, sealed with the password
+        m_crypto->clear();
+        initializeEncryption(password);
 
         // Mark all entries as encrypted and re-process
         for (auto& entry : m_entries) {
             entry.setFlags(entry.getFlags() | EntryFlags::ENCRYPTED);
         }
 
+        m_rewrite = true;
         m_modified = true;
         return true;
     }
@@ -734,18 +1674,20 @@ namespace VaultArchive {
             return false;
         }
 
-        // Derive key from password
-        std::vector<uint8_t> salt(m_header.salt.begin(), m_header.salt.end());
-
         try {
-            m_crypto->initializeFromPassword(password, salt);
+            // Derive key from password (reused if the archive was opened with it)
+            loadEncryptionKey(password);
             m_header.flags &= ~ArchiveFlags::ENCRYPTED;
+            for (auto& slot : m_header.keySlots) {
+                slot.clear();
+            }
 
             // Unmark all entries
             for (auto& entry : m_entries) {
                 entry.setFlags(entry.getFlags() & ~EntryFlags::ENCRYPTED);
             }
 
+            m_rewrite = true;
             m_modified = true;
             return true;
 
@@ -760,27 +1702,102 @@ namespace VaultArchive {
             m_errorMessage = "Archive is not encrypted";
             return false;
         }
+        if (newPassword.empty()) {
+            m_errorMessage = "Password cannot be empty";
+            return false;
+        }
+
+        int slot = -1;
+        std::vector<uint8_t> key;
+        try {
+            key = unlockDataKey(oldPassword, slot);
+        } catch (const std::exception& e) {
+            m_errorMessage = "Incorrect password";
+            return false;
+        }
+
+        // Only the slot of the old password is replaced; the data key stays
+        if (slot < 0) {
+            slot = 0;
+        }
+        sealKeySlot(m_header.keySlots[slot], newPassword, key);
+        CryptoEngine::secureWipe(key);
+
+        markKeySlotsModified();
+        return true;
+    }
+
+    bool Archive::addPassword(const std::string& password, const std::string& newPassword) {
+        if (!m_header.isEncrypted()) {
+            m_errorMessage = "Archive is not encrypted";
+            return false;
+        }
+        if (newPassword.empty()) {
+            m_errorMessage = "Password cannot be empty";
+            return false;
+        }
+
+        int slot = -1;
+        std::vector<uint8_t> key;
+        try {
+            key = unlockDataKey(password, slot);
+        } catch (const std::exception& e) {
+            m_errorMessage = "Incorrect password";
+            return false;
+        }
+
+        // The key of an archive without slots is sealed for the current password first
+        if (slot < 0) {
+            sealKeySlot(m_header.keySlots[0], password, key);
+        }
+
+        auto unused = std::find_if(m_header.keySlots.begin(), m_header.keySlots.end(),
+            [](const KeySlot& candidate) { return !candidate.isActive(); });
+        if (unused == m_header.keySlots.end()) {
+            CryptoEngine::secureWipe(key);
+            m_errorMessage = "All " + std::to_string(KEY_SLOT_COUNT) + " key slots are in use";
+            return false;
+        }
 
-        // Verify old password
-        std::vector<uint8_t> oldSalt(m_header.salt.begin(), m_header.salt.end());
-        std::vector<uint8_t> oldKey = CryptoEngine::deriveKey(oldPassword, oldSalt);
+        sealKeySlot(*unused, newPassword, key);
+        CryptoEngine::secureWipe(key);
 
-        // Generate new salt and IV
-        std::vector<uint8_t> newSalt = CryptoEngine::generateSalt();
-        std::vector<uint8_t> newIV = CryptoEngine::generateIV();
+        markKeySlotsModified();
+        return true;
+    }
 
-        // Update header
-        std::memcpy(m_header.salt.data(), newSalt.data(), newSalt.size());
-        std::memcpy(m_header.iv.data(), newIV.data(), newIV.size());
+    bool Archive::removePassword(const std::string& password) {
+        if (!m_header.isEncrypted()) {
+            m_errorMessage = "Archive is not encrypted";
+            return false;
+        }
 
-        // Re-encrypt all data with new key
-        // For now, just update the crypto state
-        m_crypto->initializeFromPassword(newPassword, newSalt);
+        int slot = -1;
+        try {
+            std::vector<uint8_t> key = unlockDataKey(password, slot);
+            CryptoEngine::secureWipe(key);
+        } catch (const std::exception& e) {
+            m_errorMessage = "Incorrect password";
+            return false;
+        }
 
-        m_modified = true;
+        if (slot < 0 || m_header.activeKeySlots() < 2) {
+            m_errorMessage = "Cannot remove the only password of the archive";
+            return false;
+        }
+
+        m_header.keySlots[slot].clear();
+        markKeySlotsModified();
         return true;
     }
 
+    size_t Archive::getPasswordCount() const {
+        if (!m_header.isEncrypted()) {
+            return 0;
+        }
+        return std::max<size_t>(m_header.activeKeySlots(), 1);
+    }
+
     const ArchiveMetadata& Archive::getMetadata() const {
         static ArchiveMetadata empty;
         return empty;
@@ -810,13 +1827,14 @@ namespace VaultArchive {
     // ======================
 
     bool Archive::readArchive(const std::string& password) {
-        if (m_archiveData.size() < 64) {
+        if (m_file.size() < GLOBAL_HEADER_SIZE_V3) {
             m_errorMessage = "Archive file too small";
             return false;
         }
 
         // Parse global header
-        std::vector<uint8_t> headerData(m_archiveData.begin(), m_archiveData.begin() + 64);
+        std::vector<uint8_t> headerData = m_file.read(0,
+            static_cast<size_t>(std::min<uint64_t>(m_file.size(), GLOBAL_HEADER_SIZE)));
         if (!m_header.deserialize(headerData)) {
             m_errorMessage = "Invalid archive header";
             return false;
@@ -827,7 +1845,10 @@ namespace VaultArchive {
             return false;
         }
 
-        size_t offset = 64;
+        if (m_header.version > ((VARC_VERSION_MAJOR << 8) | VARC_VERSION_MINOR)) {
+            m_errorMessage = "Unsupported archive version";
+            return false;
+        }
 
         // Initialize crypto if encrypted
         if (m_header.isEncrypted()) {
@@ -836,27 +1857,139 @@ namespace VaultArchive {
                 return false;
             }
 
-            std::vector<uint8_t> salt(m_header.salt.begin(), m_header.salt.end());
-
             try {
-                m_crypto->initializeFromPassword(password, salt);
+                loadEncryptionKey(password);
             } catch (const std::exception& e) {
                 m_errorMessage = "Failed to initialize encryption: " + std::string(e.what());
                 return false;
             }
         }
 
-        // Parse entries
         m_entries.clear();
+        invalidatePayloadIndex();
+        return m_header.hasIndex() ? readIndex() : readLegacyEntries();
+    }
+
+    bool Archive::readIndex() {
+        const uint64_t fileSize = m_file.size();
+        uint64_t indexOffset = m_header.indexOffset;
+        uint64_t indexSize = m_header.indexSize;
+        IndexFooter footer;
+
+        // Locate the index from the trailing footer if the header does not point at it
+        if (indexOffset == 0) {
+            if (fileSize < m_header.serializedSize() + INDEX_FOOTER_SIZE ||
+                !footer.deserialize(m_file.read(fileSize - INDEX_FOOTER_SIZE, INDEX_FOOTER_SIZE))) {
+                m_errorMessage = "Entry index not found";
+                return false;
+            }
+            indexOffset = footer.indexOffset;
+            indexSize = footer.indexSize;
+        }
+
+        if (indexOffset < m_header.serializedSize() || indexOffset > fileSize ||
+            indexSize > fileSize - indexOffset ||
+            INDEX_FOOTER_SIZE > fileSize - indexOffset - indexSize) {
+            m_errorMessage = "Invalid entry index location";
+            return false;
+        }
+
+        // Index and footer are read together
+        std::vector<uint8_t> indexData = m_file.read(indexOffset, static_cast<size_t>(indexSize + INDEX_FOOTER_SIZE));
+        if (!footer.deserialize(indexData, static_cast<size_t>(indexSize)) ||
+            footer.indexOffset != indexOffset || footer.indexSize != indexSize) {
+            m_errorMessage = "Invalid entry index footer";
+            return false;
+        }
+
+        indexData.resize(static_cast<size_t>(indexSize));
+        std::vector<uint8_t> checksum = CryptoEngine::sha256(indexData);
+        if (!std::equal(checksum.begin(), checksum.end(), footer.checksum.begin())) {
+            m_errorMessage = "Entry index checksum mismatch";
+            return false;
+        }
+
+        m_entries.reserve(footer.entryCount);
+        size_t offset = 0;
+
+        for (uint32_t i = 0; i < footer.entryCount; ++i) {
+            IndexEntry record;
+            size_t consumed = record.deserialize(indexData, offset);
+            if (consumed == 0) {
+                m_errorMessage = "Invalid entry index record";
+                return false;
+            }
+            offset += consumed;
+
+            if (record.dataOffset > fileSize || record.compressedSize > fileSize - record.dataOffset) {
+                m_errorMessage = "Entry data out of range: " + record.path;
+                return false;
+            }
+
+            VarcEntry entry = VarcEntry::fromIndexEntry(record);
+
+            // Blocks must cover the original data and the stored payload exactly
+            if (entry.isBlocked()) {
+                const BlockIndex& blocks = entry.getBlockIndex();
+                uint64_t storedSize = 0;
+                for (uint32_t size : blocks.storedSizes) {
+                    storedSize += size;
+                }
+
+                if (blocks.blockSize == 0 || storedSize != record.compressedSize ||
+                    blocks.storedSizes.size() != (record.originalSize + blocks.blockSize - 1) / blocks.blockSize) {
+                    m_errorMessage = "Invalid block index: " + record.path;
+                    return false;
+                }
+            }
+
+            // Chunks may live anywhere in the archive but must add up to the original data
+            if (entry.isChunked()) {
+                uint64_t chunkedSize = 0;
+                for (const ChunkRef& chunk : entry.getChunkList().chunks) {
+                    if (chunk.offset > fileSize || chunk.storedSize > fileSize - chunk.offset) {
+                        m_errorMessage = "Invalid chunk list: " + record.path;
+                        return false;
+                    }
+                    chunkedSize += chunk.originalSize;
+                }
+
+                if (chunkedSize != record.originalSize) {
+                    m_errorMessage = "Invalid chunk list: " + record.path;
+                    return false;
+                }
+            }
+
+            // The entry's data must lie within its solid block
+            if (entry.isSolid()) {
+                const SolidBlockRef& block = entry.getSolidBlock();
+                if (block.offset > fileSize || block.storedSize > fileSize - block.offset ||
+                    block.entryOffset > block.originalSize ||
+                    record.originalSize > block.originalSize - block.entryOffset) {
+                    m_errorMessage = "Invalid solid block: " + record.path;
+                    return false;
+                }
+            }
+
+            m_entries.push_back(std::move(entry));
+        }
+
+        return true;
+    }
+
+    bool Archive::readLegacyEntries() {
+        // Format 0.3 archives have no index; walk the entries in sequence
+        uint64_t offset = GLOBAL_HEADER_SIZE_V3;
+        const uint64_t fileSize = m_file.size();
+
         for (uint32_t i = 0; i < m_header.fileCount; ++i) {
-            if (offset + EntryHeader::fixedSize() > m_archiveData.size()) {
+            if (offset + EntryHeader::fixedSize() > fileSize) {
                 m_errorMessage = "Unexpected end of archive";
                 return false;
             }
 
             // Read entry header
-            std::vector<uint8_t> entryHeaderData(m_archiveData.begin() + offset,
-                m_archiveData.begin() + offset + EntryHeader::fixedSize());
+            std::vector<uint8_t> entryHeaderData = m_file.read(offset, EntryHeader::fixedSize());
             offset += EntryHeader::fixedSize();
 
             EntryHeader entryHeader;
@@ -866,41 +1999,50 @@ namespace VaultArchive {
             }
 
             // Read path
-            if (offset + entryHeader.pathLength > m_archiveData.size()) {
+            if (offset + entryHeader.pathLength > fileSize) {
                 m_errorMessage = "Unexpected end of archive (path)";
                 return false;
             }
 
-            std::string path(reinterpret_cast<const char*>(m_archiveData.data() + offset), entryHeader.pathLength);
+            std::vector<uint8_t> pathData = m_file.read(offset, entryHeader.pathLength);
+            std::string path(pathData.begin(), pathData.end());
             offset += entryHeader.pathLength;
 
-            // Read data
+            // Skip data; the entry references it by offset
+            uint64_t dataOffset = offset;
             uint64_t dataSize = entryHeader.compressedSize;
-            if (offset + dataSize > m_archiveData.size()) {
+            if (dataSize > fileSize - offset) {
                 m_errorMessage = "Unexpected end of archive (data)";
                 return false;
             }
-
-            std::vector<uint8_t> data(m_archiveData.begin() + offset,
-                m_archiveData.begin() + offset + dataSize);
             offset += dataSize;
 
             // Read checksum
-            if (offset + 32 > m_archiveData.size()) {
+            if (offset + 32 > fileSize) {
                 m_errorMessage = "Unexpected end of archive (checksum)";
                 return false;
             }
 
-            std::vector<uint8_t> checksum(m_archiveData.begin() + offset,
-                m_archiveData.begin() + offset + 32);
+            std::vector<uint8_t> checksum = m_file.read(offset, 32);
             offset += 32;
 
-            // Create entry
-            VarcEntry entry(path, VarcEntry::Type::FILE, entryHeader.originalSize, entryHeader.fileType);
-            entry.setCompressedSize(entryHeader.compressedSize);
-            entry.setFlags(entryHeader.flags);
-            entry.setChecksum(checksum);
-            entry.setData(std::move(data));
+            // Tombstoned by an in-place remove
+            if (entryHeader.flags & EntryFlags::DELETED) {
+                continue;
+            }
+
+            // Solid block locations are only recorded in the index
+            if (entryHeader.flags & EntryFlags::SOLID) {
+                m_errorMessage = "Solid entry without entry index: " + path;
+                return false;
+            }
+
+            // Create entry
+            VarcEntry entry(path, VarcEntry::Type::FILE, entryHeader.originalSize, entryHeader.fileType);
+            entry.setCompressedSize(entryHeader.compressedSize);
+            entry.setFlags(entryHeader.flags);
+            entry.setChecksum(checksum);
+            entry.setOffset(dataOffset);
 
             m_entries.push_back(std::move(entry));
         }
@@ -908,33 +2050,56 @@ namespace VaultArchive {
         return true;
     }
 
-    bool Archive::writeArchive() {
-        updateHeader();
+    bool Archive::writeArchive(OutputFile& output, std::vector<IndexEntry>& records) {
+        // Appending to the open archive: stored payloads stay where they are
+        const bool appending = output.isAppending();
+        updateHeader(appending);
 
-        // Calculate total size
-        size_t totalSize = 64;  // Global header
+        // Reserve the final size up front
+        uint64_t totalSize = m_header.serializedSize() + INDEX_FOOTER_SIZE;
+        size_t indexSize = 0;
 
         for (const auto& entry : m_entries) {
-            uint32_t pathLength = static_cast<uint32_t>(entry.getPath().length());
-            totalSize += EntryHeader::fixedSize();
-            totalSize += pathLength;
-            totalSize += entry.getCompressedSize();
-            totalSize += 32;  // Checksum
+            uint64_t pathLength = entry.getPath().length();
+            totalSize += EntryHeader::fixedSize() + pathLength + entry.getCompressedSize() + CHECKSUM_SIZE;
+            indexSize += INDEX_ENTRY_SIZE + pathLength;
         }
+        totalSize += indexSize;
 
-        m_archiveData.resize(totalSize);
-        size_t offset = 0;
-
-        // Write global header
-        std::vector<uint8_t> headerData = m_header.serialize();
-        if (headerData.size() < 64) {
-            headerData.resize(64, 0);
+        if (!appending) {
+            output.preallocate(totalSize);
         }
-        std::memcpy(m_archiveData.data() + offset, headerData.data(), 64);
-        offset += 64;
+
+        records.clear();
+        records.reserve(m_entries.size());
+        std::vector<uint8_t> indexData;
+        indexData.reserve(indexSize);
+
+        // Payloads and chunks already copied from the open file (old offset -> new offset)
+        std::unordered_map<uint64_t, uint64_t> copiedPayloads;
+        std::unordered_map<uint64_t, uint64_t> copiedChunks = m_copiedChunks;
 
         // Write entries
         for (const auto& entry : m_entries) {
+            if (entry.isStaged() || (appending && !entry.isLoaded())) {
+                // Already streamed into the output by streamEntry(), or already in the appended file
+                records.push_back(entry.getIndexEntry());
+                records.back().serialize(indexData);
+                continue;
+            }
+
+            // Deduplicated entries only get an index record pointing at the shared payload
+            if (!entry.isLoaded() && !entry.isChunked() && !entry.isSolid()) {
+                auto copied = copiedPayloads.find(entry.getOffset());
+                if (copied != copiedPayloads.end()) {
+                    IndexEntry record = entry.getIndexEntry();
+                    record.dataOffset = copied->second;
+                    record.serialize(indexData);
+                    records.push_back(std::move(record));
+                    continue;
+                }
+            }
+
             uint32_t pathLength = static_cast<uint32_t>(entry.getPath().length());
 
             // Write entry header
@@ -945,89 +2110,1559 @@ namespace VaultArchive {
             entryHeader.fileType = entry.getFileType();
             entryHeader.flags = entry.getFlags();
 
-            std::vector<uint8_t> entryHeaderData = entryHeader.serialize();
-            std::memcpy(m_archiveData.data() + offset, entryHeaderData.data(), entryHeaderData.size());
-            offset += entryHeaderData.size();
+            IndexEntry record = entry.getIndexEntry();
+            uint64_t headerOffset = output.position();
+            record.dataOffset = headerOffset + EntryHeader::fixedSize() + pathLength;
+
+            // Write entry header, path, data and checksum
+            bool written = output.write(entryHeader.serialize()) &&
+                output.write(reinterpret_cast<const uint8_t*>(entry.getPath().data()), pathLength);
+
+            if (entry.isChunked() || entry.isSolid()) {
+                // Chunks or solid blocks shared with earlier entries are not copied
+                // again, so the header is rewritten with the size actually stored here
+                written = written && copyEntryChunks(entry, output, record, copiedChunks) &&
+                    output.write(record.checksum.data(), CHECKSUM_SIZE);
+                if (written) {
+                    entryHeader.compressedSize = record.compressedSize;
+                    std::vector<uint8_t> headerData = entryHeader.serialize();
+                    written = output.writeAt(headerOffset, headerData.data(), headerData.size());
+                }
+            } else {
+                written = written && copyEntryPayload(entry, output) &&
+                    output.write(record.checksum.data(), CHECKSUM_SIZE);
+            }
 
-            // Write path
-            std::memcpy(m_archiveData.data() + offset, entry.getPath().data(), pathLength);
-            offset += pathLength;
+            if (!written) {
+                if (m_errorMessage.empty()) {
+                    m_errorMessage = "Failed to write entry: " + entry.getPath();
+                }
+                return false;
+            }
 
-            // Write data
-            const auto& data = entry.getData();
-            std::memcpy(m_archiveData.data() + offset, data.data(), data.size());
-            offset += data.size();
+            if (!entry.isLoaded() && !entry.isChunked() && !entry.isSolid()) {
+                copiedPayloads.emplace(entry.getOffset(), record.dataOffset);
+            }
+            record.serialize(indexData);
+            records.push_back(std::move(record));
+        }
 
-            // Write checksum
-            const auto& checksum = entry.getChecksum();
-            std::memcpy(m_archiveData.data() + offset, checksum.data(), 32);
-            offset += 32;
+        // Removed entries are dropped from the new index; when appending, their
+        // entry headers are also marked so the payloads are known to be dead
+        if (appending && !writeTombstones(output)) {
+            return false;
+        }
+
+        // Write entry index and footer
+        IndexFooter footer;
+        footer.entryCount = static_cast<uint32_t>(m_entries.size());
+        footer.indexOffset = output.position();
+        footer.indexSize = indexData.size();
+        std::vector<uint8_t> indexChecksum = CryptoEngine::sha256(indexData);
+        std::copy(indexChecksum.begin(), indexChecksum.end(), footer.checksum.begin());
+
+        m_header.indexOffset = footer.indexOffset;
+        m_header.indexSize = footer.indexSize;
+        std::vector<uint8_t> headerData = m_header.serialize();
+
+        // When appending, the header is the commit point: the new index must be
+        // on disk before the header points at it
+        if (!output.write(indexData) || !output.write(footer.serialize()) ||
+            (appending && !output.sync()) ||
+            !output.writeAt(0, headerData.data(), headerData.size())) {
+            m_errorMessage = "Failed to write entry index";
+            return false;
         }
 
         return true;
     }
 
-    bool Archive::processEntry(VarcEntry& entry, const CreateOptions& options) {
-        const auto& data = entry.getData();
+    bool Archive::copyEntryPayload(const VarcEntry& entry, OutputFile& output) {
+        if (entry.isLoaded()) {
+            return output.write(entry.getData());
+        }
 
-        if (options.encrypt && !options.password.empty()) {
-            // Encrypt data
-            if (!m_crypto->isInitialized()) {
-                std::vector<uint8_t> salt = CryptoEngine::generateSalt();
-                m_crypto->initializeFromPassword(options.password, salt);
+        uint64_t size = entry.getCompressedSize();
 
-                // Update header with salt/IV
-                std::memcpy(m_header.salt.data(), salt.data(), salt.size());
-                std::memcpy(m_header.iv.data(), m_crypto->generateIV().data(), 16);
-                m_header.flags |= ArchiveFlags::ENCRYPTED;
+        // Write straight out of the mapping
+        if (m_file.isMapped() && m_copyRate == 0) {
+            return output.write(m_file.data() + entry.getOffset(), static_cast<size_t>(size));
+        }
+
+        std::vector<uint8_t> buffer(static_cast<size_t>(std::min<uint64_t>(size, 1024 * 1024)));
+        for (uint64_t copied = 0; copied < size; ) {
+            size_t chunk = static_cast<size_t>(std::min<uint64_t>(size - copied, buffer.size()));
+            if (!m_file.read(entry.getOffset() + copied, buffer.data(), chunk)) {
+                m_errorMessage = "Failed to read entry data: " + entry.getPath();
+                return false;
+            }
+            if (!output.write(buffer.data(), chunk)) {
+                return false;
             }
+            throttleCopy(chunk);
+            copied += chunk;
+        }
 
-            std::vector<uint8_t> encrypted = m_crypto->encrypt(data);
-            entry.setData(std::move(encrypted));
-            entry.setFlags(entry.getFlags() | EntryFlags::ENCRYPTED);
+        return true;
+    }
+
+    bool Archive::writeTombstones(OutputFile& output) {
+        // A payload still used by a live entry keeps its header
+        std::set<uint64_t> live;
+        for (const auto& entry : m_entries) {
+            if (!entry.isStaged() && !entry.isLoaded()) {
+                live.insert(entry.getOffset());
+            }
         }
 
-        if (options.compress) {
-            // Compress data
-            CompressionResult result = m_compression->compress(entry.getData());
+        for (const auto& removed : m_removed) {
+            const std::string& path = removed.getPath();
+            const uint64_t headerSize = EntryHeader::fixedSize() + path.length();
+            if (live.count(removed.getOffset()) || removed.getOffset() < m_header.serializedSize() + headerSize) {
+                continue;
+            }
 
-            if (result.success) {
-                entry.setData(std::move(result.compressedData));
-                entry.setCompressedSize(result.compressedSize);
-                entry.setFlags(entry.getFlags() | EntryFlags::COMPRESSED);
+            // Deduplicated entries point at another entry's payload and have no header of their own
+            uint64_t headerOffset = removed.getOffset() - headerSize;
+            std::vector<uint8_t> stored = m_file.read(headerOffset, static_cast<size_t>(headerSize));
+            EntryHeader header;
+            if (stored.size() != headerSize || !header.deserialize(stored) || header.pathLength != path.length() ||
+                !std::equal(path.begin(), path.end(), stored.begin() + EntryHeader::fixedSize())) {
+                continue;
+            }
+
+            header.flags |= EntryFlags::DELETED;
+            std::vector<uint8_t> headerData = header.serialize();
+            if (!output.writeAt(headerOffset, headerData.data(), headerData.size())) {
+                m_errorMessage = "Failed to mark removed entry: " + path;
+                return false;
             }
         }
 
-        m_entries.push_back(std::move(entry));
-        m_modified = true;
+        return true;
+    }
+
+    void Archive::throttleCopy(uint64_t bytes) {
+        if (m_copyRate == 0) {
+            return;
+        }
+
+        // Sleep until the bytes copied so far fit within the rate limit
+        m_copiedBytes += bytes;
+        std::this_thread::sleep_until(m_copyStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(static_cast<double>(m_copiedBytes) / static_cast<double>(m_copyRate))));
+    }
+
+    bool Archive::copyEntryChunks(
+        const VarcEntry& entry,
+        OutputFile& output,
+        IndexEntry& record,
+        std::unordered_map<uint64_t, uint64_t>& copiedChunks
+    ) {
+        uint64_t storedSize = 0;
+        std::vector<uint8_t> buffer;
+
+        // Copy a stored chunk or block unless an earlier entry already did
+        auto copySegment = [&](uint64_t& offset, uint32_t size) {
+            auto copied = copiedChunks.find(offset);
+            if (copied != copiedChunks.end()) {
+                offset = copied->second;
+                return true;
+            }
+
+            uint64_t newOffset = output.position();
+            if (m_file.isMapped()) {
+                if (!output.write(m_file.data() + offset, size)) {
+                    return false;
+                }
+            } else {
+                buffer.resize(size);
+                if (!m_file.read(offset, buffer.data(), buffer.size()) || !output.write(buffer)) {
+                    m_errorMessage = "Failed to read entry data: " + entry.getPath();
+                    return false;
+                }
+            }
+            throttleCopy(size);
+
+            copiedChunks.emplace(offset, newOffset);
+            offset = newOffset;
+            storedSize += size;
+            return true;
+        };
+
+        if (entry.isSolid()) {
+            SolidBlockRef block = entry.getSolidBlock();
+            if (!copySegment(block.offset, block.storedSize)) {
+                return false;
+            }
+            record.compressedSize = storedSize;
+            record.setExtra(IndexExtraTag::SOLID_BLOCK, block.serialize());
+            return true;
+        }
+
+        ChunkList chunks = entry.getChunkList();
+        for (auto& chunk : chunks.chunks) {
+            if (!copySegment(chunk.offset, chunk.storedSize)) {
+                return false;
+            }
+        }
+
+        record.compressedSize = storedSize;
+        record.setExtra(IndexExtraTag::CHUNK_LIST, chunks.serialize());
 
         return true;
     }
 
-    VarcEntry Archive::createEntryFromPath(const std::string& filepath) {
-        std::ifstream file(filepath, std::ios::binary | std::ios::ate);
-        if (!file.is_open()) {
-            throw std::runtime_error("Cannot open file: " + filepath);
+    std::vector<uint8_t> Archive::readEntryPayload(const VarcEntry& entry) const {
+        if (entry.isLoaded()) {
+            return entry.getData();
+        }
+
+        std::vector<uint8_t> data(static_cast<size_t>(entry.getCompressedSize()));
+        if (!readStoredData(entry, 0, data.data(), data.size())) {
+            return {};
         }
+        return data;
+    }
 
-        std::streamsize size = file.tellg();
-        file.seekg(0, std::ios::beg);
+    bool Archive::readStoredData(const VarcEntry& entry, uint64_t offset, uint8_t* buffer, size_t length) const {
+        return readArchiveData(entry.isStaged(), entry.getOffset() + offset, buffer, length);
+    }
 
-        std::vector<uint8_t> data(size);
-        if (!file.read(reinterpret_cast<char*>(data.data()), size)) {
-            throw std::runtime_error("Failed to read file: " + filepath);
+    bool Archive::readArchiveData(bool staged, uint64_t offset, uint8_t* buffer, size_t length) const {
+        if (staged) {
+            return m_output && m_output->read(offset, buffer, length);
         }
 
-        file.close();
+        return m_file.read(offset, buffer, length);
+    }
 
-        // Get relative path (strip common prefix if any)
-        std::string relativePath = filepath;
+    bool Archive::decodeEntry(const VarcEntry& entry, const std::function<void(const uint8_t*, size_t)>& output,
+        ThreadPool* pool) {
+        const uint64_t storedSize = entry.isLoaded() ? entry.getData().size() : entry.getCompressedSize();
 
-        VarcEntry entry(relativePath, data, VarcEntry::Type::FILE);
-        return entry;
+        if (entry.isEncrypted() && !m_crypto->isInitialized()) {
+            m_errorMessage = "Password required for encrypted archive";
+            return false;
+        }
+
+        if (entry.isSolid()) {
+            try {
+                const std::vector<uint8_t>& block = loadSolidBlock(entry);
+                const uint8_t* data = block.data() + entry.getSolidBlock().entryOffset;
+                const size_t length = static_cast<size_t>(entry.getOriginalSize());
+
+                HashStream hash;
+                hash.update(data, length);
+                if (hash.finalize() != entry.getChecksum()) {
+                    m_errorMessage = "Checksum mismatch: " + entry.getPath();
+                    return false;
+                }
+                output(data, length);
+            } catch (const std::exception& e) {
+                m_errorMessage = "Failed to extract " + entry.getPath() + ": " + e.what();
+                return false;
+            }
+            return true;
+        }
+
+        // Chunks may be scattered across the archive, so only contiguous payloads get the hint
+        if (!entry.isLoaded() && !entry.isStaged() && !entry.isChunked()) {
+            m_file.adviseSequential(entry.getOffset(), storedSize);
+        }
+
+        if (entry.isBlocked() || entry.isChunked()) {
+            return decodeBlocks(entry, output, pool);
+        }
+
+        // Payloads sealed with AES-GCM, compressed before encryption or compressed with another
+        // codec than deflate are decoded whole (they are at most one block); the rest is streamed
+        if (entry.isAuthenticated() || (entry.isCompressed() &&
+            (entry.getCodec() != CodecId::DEFLATE || (entry.isEncrypted() && entry.isCompressedFirst())))) {
+            try {
+                std::vector<uint8_t> stored(static_cast<size_t>(storedSize));
+                if (entry.isLoaded()) {
+                    if (entry.getData().size() < stored.size()) {
+                        throw std::runtime_error("Failed to read entry data");
+                    }
+                    std::memcpy(stored.data(), entry.getData().data(), stored.size());
+                } else if (!readStoredData(entry, 0, stored.data(), stored.size())) {
+                    throw std::runtime_error("Failed to read entry data");
+                }
+
+                std::vector<uint8_t> plain = decodeBlock(entry, std::move(stored),
+                    static_cast<size_t>(entry.getOriginalSize()));
+                if (CryptoEngine::sha256(plain) != entry.getChecksum()) {
+                    m_errorMessage = "Checksum mismatch: " + entry.getPath();
+                    return false;
+                }
+                output(plain.data(), plain.size());
+            } catch (const std::exception& e) {
+                m_errorMessage = "Failed to extract " + entry.getPath() + ": " + e.what();
+                return false;
+            }
+            return true;
+        }
+
+        std::unique_ptr<CipherStream> cipher;
+        if (entry.isEncrypted()) {
+            cipher = m_crypto->createCipherStream(false);
+        }
+
+        uint64_t consumed = 0;
+        uint64_t written = 0;
+        HashStream hash;
+        std::vector<uint8_t> plaintext;
+
+        // Read the next piece of the stored payload
+        auto readStored = [&](uint8_t* buffer, size_t capacity) -> size_t {
+            size_t length = static_cast<size_t>(std::min<uint64_t>(capacity, storedSize - consumed));
+            if (length == 0) {
+                return 0;
+            }
+
+            if (entry.isLoaded()) {
+                std::memcpy(buffer, entry.getData().data() + consumed, length);
+            } else if (!readStoredData(entry, consumed, buffer, length)) {
+                throw std::runtime_error("Failed to read entry data");
+            }
+
+            consumed += length;
+            return length;
+        };
+
+        // Hash and hand on the original file contents
+        auto emit = [&](const uint8_t* data, size_t length) {
+            hash.update(data, length);
+            output(data, length);
+            written += length;
+        };
+
+        // Older encrypted entries were compressed after encryption, so decryption follows inflation
+        auto decrypt = [&](const uint8_t* data, size_t length) {
+            if (!cipher) {
+                emit(data, length);
+                return;
+            }
+            plaintext.resize(length + CryptoEngine::AES_BLOCK_SIZE);
+            emit(plaintext.data(), cipher->update(data, length, plaintext.data()));
+        };
+
+        // Nothing is stored for empty files
+        if (storedSize > 0) {
+            try {
+                if (entry.isCompressed()) {
+                    DecompressionResult result = m_compression->decompressStreaming(readStored, decrypt);
+                    if (!result.success) {
+                        m_errorMessage = "Failed to decompress " + entry.getPath() + ": " + result.errorMessage;
+                        return false;
+                    }
+                } else {
+                    std::vector<uint8_t> buffer(STREAM_CHUNK_SIZE);
+                    while (size_t length = readStored(buffer.data(), buffer.size())) {
+                        decrypt(buffer.data(), length);
+                    }
+                }
+
+                if (cipher) {
+                    uint8_t tail[CryptoEngine::AES_BLOCK_SIZE];
+                    emit(tail, cipher->finalize(tail));
+                }
+            } catch (const std::exception& e) {
+                m_errorMessage = "Failed to extract " + entry.getPath() + ": " + e.what();
+                return false;
+            }
+        }
+
+        if (written != entry.getOriginalSize() || hash.finalize() != entry.getChecksum()) {
+            m_errorMessage = "Checksum mismatch: " + entry.getPath();
+            return false;
+        }
+
+        return true;
+    }
+
+    bool Archive::decodeBlocks(const VarcEntry& entry, const std::function<void(const uint8_t*, size_t)>& output,
+        ThreadPool* pool) {
+        const uint64_t originalSize = entry.getOriginalSize();
+
+        uint64_t consumed = 0;
+        uint64_t written = 0;
+        HashStream hash;
+
+        // Outlives the queued blocks, which are waited for on failure
+        std::unique_ptr<SegmentCipher> stream;
+
+        // Blocks or chunks are read here, decoded by the pool and emitted in order
+        std::deque<std::future<std::vector<uint8_t>>> window;
+        const size_t maxInFlight = pool ? pool->size() * 2 : 0;
+
+        auto emit = [&](const std::vector<uint8_t>& block) {
+            hash.update(block.data(), block.size());
+            output(block.data(), block.size());
+            written += block.size();
+        };
+
+        try {
+            const std::vector<PayloadSegment> segments = payloadSegments(entry);
+            if (!segments.empty()) {
+                stream = openEntryStream(entry);
+            }
+            const SegmentCipher* cipher = stream.get();
+
+            for (uint64_t index = 0; index < segments.size(); ++index) {
+                const PayloadSegment& segment = segments[index];
+                const bool last = index + 1 == segments.size();
+                size_t plainSize = segment.originalSize;
+
+                std::vector<uint8_t> stored(segment.storedSize);
+                if (entry.isLoaded()) {
+                    if (entry.getData().size() - consumed < stored.size()) {
+                        throw std::runtime_error("Failed to read entry data");
+                    }
+                    std::memcpy(stored.data(), entry.getData().data() + consumed, stored.size());
+                } else if (!readArchiveData(entry.isStaged(), segment.offset, stored.data(), stored.size())) {
+                    throw std::runtime_error("Failed to read entry data");
+                }
+                consumed += stored.size();
+
+                if (!pool) {
+                    emit(decodeBlock(entry, std::move(stored), plainSize, cipher, index, last));
+                    continue;
+                }
+
+                if (window.size() >= maxInFlight) {
+                    emit(window.front().get());
+                    window.pop_front();
+                }
+
+                window.push_back(pool->submit(
+                    [this, &entry, stored = std::move(stored), plainSize, cipher, index, last]() mutable {
+                        return decodeBlock(entry, std::move(stored), plainSize, cipher, index, last);
+                    }));
+            }
+
+            while (!window.empty()) {
+                emit(window.front().get());
+                window.pop_front();
+            }
+        } catch (const std::exception& e) {
+            // Queued blocks still reference the entry
+            for (auto& pending : window) {
+                if (pending.valid()) {
+                    pending.wait();
+                }
+            }
+            m_errorMessage = "Failed to extract " + entry.getPath() + ": " + e.what();
+            return false;
+        }
+
+        if (written != originalSize || hash.finalize() != entry.getChecksum()) {
+            m_errorMessage = "Checksum mismatch: " + entry.getPath();
+            return false;
+        }
+
+        return true;
+    }
+
+    std::vector<uint8_t> Archive::decodeBlock(const VarcEntry& entry, std::vector<uint8_t> stored,
+        size_t plainSize, const SegmentCipher* stream, uint64_t index, bool last) const {
+        // Compressed, then encrypted: decryption (and authentication) comes first
+        const bool compressedFirst = entry.isEncrypted() && entry.isCompressedFirst();
+        if (compressedFirst && entry.isStreamed()) {
+            if (!stream) {
+                throw std::runtime_error("Missing stream header");
+            }
+
+            // The first segment follows the stream header
+            const size_t header = index == 0 ? SegmentCipher::HEADER_SIZE : 0;
+            if (stored.size() < header + SegmentCipher::TAG_SIZE) {
+                throw std::runtime_error("Block is truncated");
+            }
+            std::vector<uint8_t> opened(stored.size() - header - SegmentCipher::TAG_SIZE);
+            stream->open(index, last, stored.data() + header, stored.size() - header, opened.data());
+            stored = std::move(opened);
+        } else if (compressedFirst) {
+            stored = entry.isAuthenticated() ? m_crypto->unseal(stored) : m_crypto->decrypt(stored);
+        }
+
+        if (entry.isCompressed()) {
+            // Older encrypt-then-compress payloads inflate to the padded ciphertext
+            size_t inflatedSize = entry.isEncrypted() && !compressedFirst ?
+                (plainSize / CryptoEngine::AES_BLOCK_SIZE + 1) * CryptoEngine::AES_BLOCK_SIZE : plainSize;
+
+            DecompressionResult result = m_compression->decompress(stored, inflatedSize, entry.getCodec());
+            if (!result.success) {
+                throw std::runtime_error(result.errorMessage);
+            }
+            if (result.decompressedSize != inflatedSize) {
+                throw std::runtime_error("Decompressed size mismatch");
+            }
+            stored = std::move(result.decompressedData);
+        }
+
+        if (entry.isEncrypted() && !compressedFirst) {
+            stored = m_crypto->decrypt(stored);
+        }
+
+        if (stored.size() != plainSize) {
+            throw std::runtime_error("Block size mismatch");
+        }
+
+        return stored;
+    }
+
+    std::unique_ptr<SegmentCipher> Archive::openEntryStream(const VarcEntry& entry) const {
+        if (!entry.isEncrypted() || !entry.isStreamed()) {
+            return nullptr;
+        }
+
+        // The stream header starts the stored payload
+        uint8_t header[SegmentCipher::HEADER_SIZE];
+        if (entry.isLoaded()) {
+            if (entry.getData().size() < sizeof(header)) {
+                throw std::runtime_error("Failed to read stream header");
+            }
+            std::memcpy(header, entry.getData().data(), sizeof(header));
+        } else if (entry.getCompressedSize() < sizeof(header) || !readStoredData(entry, 0, header, sizeof(header))) {
+            throw std::runtime_error("Failed to read stream header");
+        }
+
+        return m_crypto->createSegmentCipher(header);
+    }
+
+    const std::vector<uint8_t>& Archive::loadSolidBlock(const VarcEntry& entry) {
+        const SolidBlockRef& block = entry.getSolidBlock();
+
+        if (m_solidCache.data.empty() || m_solidCache.offset != block.offset ||
+            m_solidCache.staged != entry.isStaged()) {
+            std::vector<uint8_t> stored(block.storedSize);
+            if (!readArchiveData(entry.isStaged(), block.offset, stored.data(), stored.size())) {
+                throw std::runtime_error("Failed to read entry data");
+            }
+
+            CryptoEngine::secureWipe(m_solidCache.data);
+            m_solidCache.data = decodeBlock(entry, std::move(stored), block.originalSize);
+            m_solidCache.offset = block.offset;
+            m_solidCache.staged = entry.isStaged();
+        }
+
+        if (block.entryOffset > m_solidCache.data.size() ||
+            entry.getOriginalSize() > m_solidCache.data.size() - block.entryOffset) {
+            throw std::runtime_error("Entry outside its solid block");
+        }
+
+        return m_solidCache.data;
+    }
+
+    bool Archive::beginOutput(const std::string& path) {
+        if (path.empty()) {
+            m_errorMessage = "No output path specified";
+            return false;
+        }
+
+        auto output = std::make_unique<OutputFile>();
+
+        // Entries that are only added go onto the end of the open archive,
+        // so the existing payloads are neither read nor copied. Key slots
+        // added to an older archive need the larger header of a rewrite.
+        const bool headerFits = m_header.hasKeySlots() || m_header.activeKeySlots() == 0;
+        if (!m_rewrite && m_file.isOpen() && m_file.path() == path && m_header.hasIndex() && headerFits &&
+            output->append(path)) {
+            m_output = std::move(output);
+            m_copiedChunks.clear();
+            return true;
+        }
+
+        // Global header is written last, once the index location is known
+        if (!output->create(path) || !output->write(std::vector<uint8_t>(GLOBAL_HEADER_SIZE, 0))) {
+            m_errorMessage = "Cannot create archive file: " + path;
+            return false;
+        }
+
+        m_output = std::move(output);
+        m_copiedChunks.clear();
+        return true;
+    }
+
+    bool Archive::addStreamedFile(const std::string& filepath, const CreateOptions& options, ThreadPool* pool) {
+        VarcEntry entry = createEntryFromPath(filepath);
+
+        // Hash first so a duplicate is never compressed or written
+        if (options.deduplicate) {
+            std::vector<uint8_t> checksum;
+            if (!hashFile(filepath, checksum)) {
+                m_errorMessage = "Cannot read file: " + filepath;
+                return false;
+            }
+            if (addSharedEntry(entry, checksum)) {
+                return true;
+            }
+        }
+
+        return streamEntry(entry, filepath, options, pool);
     }
 
-    void Archive::updateHeader() {
+    void Archive::addSolidFiles(
+        const std::vector<std::string>& files,
+        const std::vector<uint64_t>& fileSizes,
+        const CreateOptions& options,
+        ThreadPool* pool,
+        const std::function<void(size_t, bool)>& finished
+    ) {
+        const bool encrypt = options.encrypt && !options.password.empty();
+        if (encrypt) {
+            initializeEncryption(options.password);
+        }
+
+        struct SolidBlock {
+            std::vector<uint8_t> data;          // Concatenated original data
+            std::vector<VarcEntry> entries;     // Entries in block order (block reference set)
+            std::vector<size_t> files;          // Input position of each entry
+        };
+
+        struct StoredBlock {
+            std::vector<uint8_t> data;          // Payload as written
+            uint8_t codec;                      // Codec it was compressed with (CodecId::STORE = not)
+        };
+
+        struct PendingBlock {
+            SolidBlock block;
+            std::future<StoredBlock> stored;
+        };
+
+        // Blocks are encoded by the pool and written in order
+        std::deque<PendingBlock> window;
+        const size_t maxInFlight = pool ? pool->size() * 2 : 1;
+        SolidBlock current;
+        std::unordered_map<std::string, uint32_t> contents;   // Dedup: contents in the current block -> offset
+
+        // The block is the payload of its first entry; the others only get a header
+        auto writeBlock = [&](PendingBlock& pending) {
+            SolidBlock& block = pending.block;
+            bool written = true;
+
+            try {
+                StoredBlock encoded = pending.stored.get();
+                const std::vector<uint8_t>& stored = encoded.data;
+                if (!m_output && !beginOutput(m_filepath)) {
+                    written = false;
+                }
+
+                SolidBlockRef ref;
+                ref.storedSize = static_cast<uint32_t>(stored.size());
+                ref.originalSize = static_cast<uint32_t>(block.data.size());
+
+                const uint32_t codec = codecFlags(encoded.codec);
+
+                for (size_t i = 0; written && i < block.entries.size(); ++i) {
+                    VarcEntry& entry = block.entries[i];
+                    if (i == 0) {
+                        ref.offset = m_output->position() + EntryHeader::fixedSize() + entry.getPath().length();
+                    }
+
+                    ref.entryOffset = entry.getSolidBlock().entryOffset;
+                    entry.setSolidBlock(ref);
+                    entry.setFlags(entry.getFlags() | codec);
+                    entry.setCompressedSize(i == 0 ? stored.size() : 0);
+                    written = appendEntry(entry, i == 0 ? stored : std::vector<uint8_t>());
+                }
+            } catch (const std::exception& e) {
+                m_errorMessage = std::string("Failed to encode solid block: ") + e.what();
+                written = false;
+            }
+
+            for (size_t file : block.files) {
+                finished(file, written);
+            }
+        };
+
+        auto flushBlock = [&]() {
+            if (current.entries.empty()) {
+                return;
+            }
+
+            if (window.size() >= maxInFlight) {
+                writeBlock(window.front());
+                window.pop_front();
+            }
+
+            // The block is kept uncompressed unless compression shrinks it, then encrypted
+            auto encode = [this, data = current.data, encrypt, codec = entryCodec(options),
+                           level = options.compressionLevel]() mutable {
+                compressPayload(data, codec, level);
+                return StoredBlock{encodeBlock(std::move(data), encrypt, CodecId::STORE, level), codec};
+            };
+
+            window.push_back({std::move(current),
+                pool ? pool->submit(std::move(encode)) : std::async(std::launch::deferred, std::move(encode))});
+            current = SolidBlock();
+            contents.clear();
+        };
+
+        for (size_t i = 0; i < files.size(); ++i) {
+            const std::string& path = files[i];
+
+            // Large files keep their own payload (and blocks or chunks)
+            if (fileSizes[i] > SOLID_ENTRY_LIMIT) {
+                finished(i, addStreamedFile(path, options, pool));
+                continue;
+            }
+
+            std::ifstream input(path, std::ios::binary);
+            std::vector<uint8_t> data(static_cast<size_t>(fileSizes[i]));
+            if (!input.is_open() ||
+                (!input.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())) &&
+                 input.bad())) {
+                m_errorMessage = "Cannot read file: " + path;
+                finished(i, false);
+                continue;
+            }
+            data.resize(static_cast<size_t>(input.gcount()));
+
+            VarcEntry entry = createEntryFromPath(path);
+            entry.setOriginalSize(data.size());
+            entry.setChecksum(CryptoEngine::sha256(data));
+            if (!data.empty()) {
+                entry.setFileType(FileType::detect(data.data(), data.size()));
+            }
+
+            if (options.deduplicate) {
+                if (addSharedEntry(entry, entry.getChecksum())) {
+                    finished(i, true);
+                    continue;
+                }
+            }
+
+            uint32_t flags = EntryFlags::SOLID;
+            if (encrypt) {
+                flags |= ENCRYPTED_ENTRY_FLAGS;
+            }
+            entry.setFlags(entry.getFlags() | flags);
+
+            // Identical contents within the block share one copy
+            SolidBlockRef ref;
+            std::string key = payloadKey(entry.getChecksum(), data.size());
+            auto stored = options.deduplicate ? contents.find(key) : contents.end();
+            if (stored != contents.end()) {
+                ref.entryOffset = stored->second;
+            } else {
+                ref.entryOffset = static_cast<uint32_t>(current.data.size());
+                current.data.insert(current.data.end(), data.begin(), data.end());
+                if (options.deduplicate) {
+                    contents.emplace(std::move(key), ref.entryOffset);
+                }
+            }
+            entry.setSolidBlock(ref);
+
+            current.entries.push_back(std::move(entry));
+            current.files.push_back(i);
+
+            if (current.data.size() >= SOLID_BLOCK_SIZE) {
+                flushBlock();
+            }
+        }
+
+        flushBlock();
+        while (!window.empty()) {
+            writeBlock(window.front());
+            window.pop_front();
+        }
+    }
+
+    bool Archive::addSharedEntry(VarcEntry& entry, const std::vector<uint8_t>& checksum) {
+        const VarcEntry* source = findPayload(checksum, entry.getOriginalSize());
+        if (!source) {
+            return false;
+        }
+
+        // Decoding follows the stored payload, so its encoding flags come along
+        const uint32_t encoding = EntryFlags::COMPRESSED | EntryFlags::ENCRYPTED | EntryFlags::COMPRESSED_FIRST |
+            EntryFlags::AUTHENTICATED | EntryFlags::STREAMED | EntryFlags::CODEC_MASK | EntryFlags::BLOCKED | EntryFlags::CHUNKED | EntryFlags::SOLID;
+        entry.setFlags((entry.getFlags() & ~encoding) | (source->getFlags() & encoding));
+        if (source->isBlocked()) {
+            entry.setBlockIndex(source->getBlockIndex());
+        }
+        if (source->isChunked()) {
+            entry.setChunkList(source->getChunkList());
+        }
+        if (source->isSolid()) {
+            entry.setSolidBlock(source->getSolidBlock());
+        }
+
+        entry.setFileType(source->getFileType());
+        entry.setCompressedSize(source->getCompressedSize());
+        entry.setChecksum(source->getChecksum());
+        entry.setOffset(source->getOffset());
+        entry.setStaged(source->isStaged());
+
+        m_entries.push_back(std::move(entry));
+        m_modified = true;
+
+        return true;
+    }
+
+    const VarcEntry* Archive::findPayload(const std::vector<uint8_t>& checksum, uint64_t originalSize) {
+        updatePayloadIndex();
+
+        auto it = m_payloadIndex.find(payloadKey(checksum, originalSize));
+        return it != m_payloadIndex.end() ? &m_entries[it->second] : nullptr;
+    }
+
+    void Archive::updatePayloadIndex() {
+        // Index entries added since the last update
+        for (; m_payloadIndexed < m_entries.size(); ++m_payloadIndexed) {
+            const VarcEntry& entry = m_entries[m_payloadIndexed];
+            if (!entry.isLoaded() && !entry.isDirectory() && entry.getChecksum().size() == CHECKSUM_SIZE) {
+                m_payloadIndex.emplace(payloadKey(entry.getChecksum(), entry.getOriginalSize()), m_payloadIndexed);
+            }
+
+            if (entry.isChunked()) {
+                for (const auto& chunk : entry.getChunkList().chunks) {
+                    m_chunkIndex.emplace(chunkKey(chunk.checksum, entry.getFlags()),
+                        ChunkLocation{chunk.offset, chunk.storedSize, entry.isStaged()});
+                }
+            }
+        }
+    }
+
+    void Archive::invalidatePayloadIndex() {
+        // Entry positions changed; rebuilt on the next lookup
+        m_payloadIndex.clear();
+        m_chunkIndex.clear();
+        m_payloadIndexed = 0;
+        CryptoEngine::secureWipe(m_solidCache.data);
+        m_solidCache = SolidBlockCache();
+    }
+
+    bool Archive::streamEntry(VarcEntry& entry, const std::string& filepath, const CreateOptions& options,
+        ThreadPool* pool) {
+        std::ifstream input(filepath, std::ios::binary);
+        if (!input.is_open()) {
+            m_errorMessage = "Cannot open file: " + filepath;
+            return false;
+        }
+
+        if (!m_output && !beginOutput(m_filepath)) {
+            return false;
+        }
+
+        if (options.encrypt && !options.password.empty()) {
+            initializeEncryption(options.password);
+        }
+
+        // Entry header is rewritten once the stored size is known
+        uint32_t pathLength = 0;
+        uint64_t headerOffset = m_output->position();
+        std::vector<uint8_t> headerData = entry.getEntryHeader(pathLength).serialize();
+
+        if (!m_output->write(headerData) ||
+            !m_output->write(reinterpret_cast<const uint8_t*>(entry.getPath().data()), pathLength)) {
+            m_errorMessage = "Failed to write entry: " + entry.getPath();
+            return false;
+        }
+
+        uint64_t dataOffset = m_output->position();
+
+        std::string error;
+        bool encoded = options.chunkDedup ?
+            streamChunks(input, filepath, entry, options, pool, error) :
+            encodeFile(input, filepath, entry, options,
+                [this](const uint8_t* data, size_t length) {
+                    if (!m_output->write(data, length)) {
+                        throw std::runtime_error("Failed to write archive data");
+                    }
+                }, error, pool);
+
+        if (!encoded) {
+            m_errorMessage = error;
+            return false;
+        }
+
+        entry.setOffset(dataOffset);
+        entry.setStaged(true);
+
+        headerData = entry.getEntryHeader(pathLength).serialize();
+        if (!m_output->write(entry.getChecksum()) ||
+            !m_output->writeAt(headerOffset, headerData.data(), headerData.size())) {
+            m_errorMessage = "Failed to write entry: " + entry.getPath();
+            return false;
+        }
+
+        m_entries.push_back(std::move(entry));
+        m_modified = true;
+
+        return true;
+    }
+
+    bool Archive::encodeFile(
+        std::istream& input,
+        const std::string& filepath,
+        VarcEntry& entry,
+        const CreateOptions& options,
+        const std::function<void(const uint8_t*, size_t)>& output,
+        std::string& error,
+        ThreadPool* pool
+    ) const {
+        const bool encrypt = options.encrypt && !options.password.empty();
+        if (encrypt) {
+            if (!m_crypto->isInitialized()) {
+                error = "Encryption not initialized";
+                return false;
+            }
+            entry.setFlags(entry.getFlags() | ENCRYPTED_ENTRY_FLAGS);
+        }
+
+        if (options.policy.usesFileTypes() && entry.getFileType() == FileType::UNKNOWN) {
+            entry.setFileType(detectFileType(input));
+        }
+
+        const PolicyDecision encoding = decideEncoding(options, entry.getPath(), entry.getFileType(),
+            entry.getOriginalSize());
+        uint8_t codec = encoding.codec;
+        if (codec != CodecId::STORE && !worthCompressing(input, entry.getOriginalSize())) {
+            codec = CodecId::STORE;
+        }
+
+        if (splitIntoBlocks(entry.getOriginalSize(), codec, encrypt)) {
+            entry.setFlags(entry.getFlags() | codecFlags(codec));
+            return encodeBlocks(input, filepath, entry, codec, encoding.level, output, error, pool);
+        }
+
+        uint64_t originalSize = 0;
+        uint64_t storedSize = 0;
+        bool endOfInput = false;
+        HashStream hash;
+
+        // Read the next piece of the file, hashing it
+        auto readInput = [&](uint8_t* buffer, size_t capacity) -> size_t {
+            if (endOfInput) {
+                return 0;
+            }
+
+            input.read(reinterpret_cast<char*>(buffer), static_cast<std::streamsize>(capacity));
+            if (input.bad()) {
+                throw std::runtime_error("Failed to read file: " + filepath);
+            }
+
+            size_t bytesRead = static_cast<size_t>(input.gcount());
+            endOfInput = bytesRead < capacity;
+
+            if (originalSize == 0 && bytesRead > 0 && entry.getFileType() == 0) {
+                entry.setFileType(FileType::detect(buffer, bytesRead));
+            }
+
+            hash.update(buffer, bytesRead);
+            originalSize += bytesRead;
+            return bytesRead;
+        };
+
+        if (codec != CodecId::STORE || encrypt) {
+            // Whole-file payloads are at most one block, so they are compressed (and
+            // stored as-is if that does not shrink them) and sealed in memory
+            try {
+                std::vector<uint8_t> payload;
+                std::vector<uint8_t> buffer(STREAM_CHUNK_SIZE);
+                while (size_t length = readInput(buffer.data(), buffer.size())) {
+                    payload.insert(payload.end(), buffer.begin(), buffer.begin() + length);
+                }
+
+                compressPayload(payload, codec, encoding.level);
+                entry.setFlags(entry.getFlags() | codecFlags(codec));
+                if (encrypt) {
+                    payload = m_crypto->seal(payload);
+                }
+                output(payload.data(), payload.size());
+                storedSize = payload.size();
+            } catch (const std::exception& e) {
+                error = "Failed to add " + filepath + ": " + e.what();
+                return false;
+            }
+        } else {
+            try {
+                std::vector<uint8_t> buffer(STREAM_CHUNK_SIZE);
+                while (size_t length = readInput(buffer.data(), buffer.size())) {
+                    output(buffer.data(), length);
+                    storedSize += length;
+                }
+            } catch (const std::exception& e) {
+                error = "Failed to add " + filepath + ": " + e.what();
+                return false;
+            }
+        }
+
+        entry.setOriginalSize(originalSize);
+        entry.setCompressedSize(storedSize);
+        entry.setChecksum(hash.finalize());
+
+        return true;
+    }
+
+    bool Archive::encodeBlocks(
+        std::istream& input,
+        const std::string& filepath,
+        VarcEntry& entry,
+        uint8_t codec,
+        int level,
+        const std::function<void(const uint8_t*, size_t)>& output,
+        std::string& error,
+        ThreadPool* pool
+    ) const {
+        const bool encrypt = entry.isEncrypted();
+
+        // The blocks of an encrypted entry are sealed as the segments of one stream
+        std::unique_ptr<SegmentCipher> stream;
+        if (encrypt) {
+            stream = m_crypto->createSegmentCipher();
+            entry.setFlags(entry.getFlags() | EntryFlags::STREAMED);
+        }
+
+        BlockIndex blocks;
+        blocks.blockSize = ENTRY_BLOCK_SIZE;
+        uint64_t originalSize = 0;
+        uint64_t storedSize = 0;
+        HashStream hash;
+
+        // Blocks are read and hashed here, encoded by the pool and written in order
+        std::deque<std::future<std::vector<uint8_t>>> window;
+        const size_t maxInFlight = pool ? pool->size() * 2 : 0;
+
+        auto writeBlock = [&](const std::vector<uint8_t>& stored) {
+            output(stored.data(), stored.size());
+            blocks.storedSizes.push_back(static_cast<uint32_t>(stored.size()));
+            storedSize += stored.size();
+        };
+
+        uint64_t index = 0;
+        auto submit = [&](std::vector<uint8_t> block, bool last) {
+            const uint64_t blockIndex = index++;
+            const SegmentCipher* cipher = stream.get();
+
+            if (!pool) {
+                writeBlock(encodeBlock(std::move(block), encrypt, codec, level, cipher, blockIndex, last));
+                return;
+            }
+
+            if (window.size() >= maxInFlight) {
+                writeBlock(window.front().get());
+                window.pop_front();
+            }
+
+            window.push_back(pool->submit(
+                [this, block = std::move(block), encrypt, codec, level, cipher, blockIndex, last]() mutable {
+                    return encodeBlock(std::move(block), encrypt, codec, level, cipher, blockIndex, last);
+                }));
+        };
+
+        try {
+            // Each block is held until the next read shows whether it is the last one
+            std::vector<uint8_t> held;
+            bool holding = false;
+
+            for (;;) {
+                std::vector<uint8_t> block(ENTRY_BLOCK_SIZE);
+                input.read(reinterpret_cast<char*>(block.data()), static_cast<std::streamsize>(block.size()));
+                if (input.bad()) {
+                    throw std::runtime_error("Failed to read file: " + filepath);
+                }
+
+                size_t bytesRead = static_cast<size_t>(input.gcount());
+                if (bytesRead == 0) {
+                    break;
+                }
+                block.resize(bytesRead);
+
+                if (originalSize == 0 && entry.getFileType() == 0) {
+                    entry.setFileType(FileType::detect(block.data(), bytesRead));
+                }
+
+                hash.update(block.data(), bytesRead);
+                originalSize += bytesRead;
+
+                if (holding) {
+                    submit(std::move(held), false);
+                }
+                held = std::move(block);
+                holding = true;
+
+                if (bytesRead < ENTRY_BLOCK_SIZE) {
+                    break;
+                }
+            }
+
+            if (holding) {
+                submit(std::move(held), true);
+            }
+
+            while (!window.empty()) {
+                writeBlock(window.front().get());
+                window.pop_front();
+            }
+        } catch (const std::exception& e) {
+            for (auto& pending : window) {
+                if (pending.valid()) {
+                    pending.wait();
+                }
+            }
+            error = "Failed to add " + filepath + ": " + e.what();
+            return false;
+        }
+
+        entry.setOriginalSize(originalSize);
+        entry.setCompressedSize(storedSize);
+        entry.setChecksum(hash.finalize());
+        entry.setBlockIndex(blocks);
+
+        return true;
+    }
+
+    bool Archive::streamChunks(
+        std::istream& input,
+        const std::string& filepath,
+        VarcEntry& entry,
+        const CreateOptions& options,
+        ThreadPool* pool,
+        std::string& error
+    ) {
+        if (options.encrypt && !options.password.empty()) {
+            if (!m_crypto->isInitialized()) {
+                error = "Encryption not initialized";
+                return false;
+            }
+            entry.setFlags(entry.getFlags() | ENCRYPTED_ENTRY_FLAGS);
+        }
+
+        if (options.policy.usesFileTypes() && entry.getFileType() == FileType::UNKNOWN) {
+            entry.setFileType(detectFileType(input));
+        }
+
+        const PolicyDecision encoding = decideEncoding(options, entry.getPath(), entry.getFileType(),
+            entry.getOriginalSize());
+        const int level = encoding.level;
+        uint8_t codec = encoding.codec;
+        if (codec != CodecId::STORE && !worthCompressing(input, entry.getOriginalSize())) {
+            codec = CodecId::STORE;
+        }
+        entry.setFlags(entry.getFlags() | codecFlags(codec));
+
+        const bool encrypt = entry.isEncrypted();
+        const uint64_t dataOffset = m_output->position();
+
+        updatePayloadIndex();
+
+        ChunkList chunks;
+        uint64_t originalSize = 0;
+        HashStream hash;
+
+        struct PendingChunk {
+            size_t index;                      // Position in the chunk list
+            std::string key;                   // Chunk ID and encoding
+            std::future<std::vector<uint8_t>> stored;
+        };
+
+        // New chunks are encoded by the pool and written in order; repeats of a
+        // chunk still in flight are resolved once it has been written
+        std::deque<PendingChunk> window;
+        const size_t maxInFlight = pool ? pool->size() * 2 : 1;
+        std::unordered_map<std::string, size_t> pendingKeys;
+        std::vector<std::pair<size_t, size_t>> repeats;
+
+        auto writeChunk = [&](PendingChunk& pending) {
+            std::vector<uint8_t> stored = pending.stored.get();
+            ChunkRef& chunk = chunks.chunks[pending.index];
+            chunk.offset = m_output->position();
+            chunk.storedSize = static_cast<uint32_t>(stored.size());
+
+            if (!m_output->write(stored)) {
+                throw std::runtime_error("Failed to write archive data");
+            }
+
+            m_chunkIndex[pending.key] = ChunkLocation{chunk.offset, chunk.storedSize, true};
+            pendingKeys.erase(pending.key);
+        };
+
+        // Chunks stored in the open file are copied into the output once,
+        // since their offsets change when the archive is rewritten
+        auto stageChunk = [&](ChunkLocation& location) {
+            if (location.staged) {
+                return;
+            }
+
+            // Appending to the open archive: the stored chunk is already part of the output
+            if (m_output->isAppending()) {
+                location.staged = true;
+                return;
+            }
+
+            auto copied = m_copiedChunks.find(location.offset);
+            if (copied == m_copiedChunks.end()) {
+                std::vector<uint8_t> stored(location.storedSize);
+                if (!m_file.read(location.offset, stored.data(), stored.size())) {
+                    throw std::runtime_error("Failed to read archive data");
+                }
+
+                uint64_t offset = m_output->position();
+                if (!m_output->write(stored)) {
+                    throw std::runtime_error("Failed to write archive data");
+                }
+                copied = m_copiedChunks.emplace(location.offset, offset).first;
+            }
+
+            location.offset = copied->second;
+            location.staged = true;
+        };
+
+        // Keep at least one maximum-size chunk ahead of the cut point
+        std::vector<uint8_t> buffer(4 * Chunker::MAX_SIZE);
+        size_t begin = 0;
+        size_t end = 0;
+        bool endOfInput = false;
+
+        try {
+            for (;;) {
+                if (!endOfInput && end - begin < Chunker::MAX_SIZE) {
+                    std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+                    end -= begin;
+                    begin = 0;
+
+                    input.read(reinterpret_cast<char*>(buffer.data() + end),
+                        static_cast<std::streamsize>(buffer.size() - end));
+                    if (input.bad()) {
+                        throw std::runtime_error("Failed to read file: " + filepath);
+                    }
+
+                    end += static_cast<size_t>(input.gcount());
+                    endOfInput = end < buffer.size();
+                }
+
+                if (begin == end) {
+                    break;
+                }
+
+                size_t length = Chunker::cut(buffer.data() + begin, end - begin);
+                std::vector<uint8_t> data(buffer.begin() + begin, buffer.begin() + begin + length);
+                begin += length;
+
+                if (originalSize == 0 && entry.getFileType() == 0) {
+                    entry.setFileType(FileType::detect(data.data(), data.size()));
+                }
+
+                hash.update(data.data(), data.size());
+                originalSize += length;
+
+                ChunkRef chunk = {};
+                chunk.originalSize = static_cast<uint32_t>(length);
+                std::vector<uint8_t> id = CryptoEngine::sha256(data);
+                std::copy(id.begin(), id.end(), chunk.checksum.begin());
+
+                std::string key = chunkKey(chunk.checksum, entry.getFlags());
+                size_t index = chunks.chunks.size();
+                chunks.chunks.push_back(chunk);
+
+                auto inFlight = pendingKeys.find(key);
+                if (inFlight != pendingKeys.end()) {
+                    repeats.emplace_back(index, inFlight->second);
+                    continue;
+                }
+
+                auto stored = m_chunkIndex.find(key);
+                if (stored != m_chunkIndex.end()) {
+                    stageChunk(stored->second);
+                    chunks.chunks[index].offset = stored->second.offset;
+                    chunks.chunks[index].storedSize = stored->second.storedSize;
+                    continue;
+                }
+
+                if (window.size() >= maxInFlight) {
+                    writeChunk(window.front());
+                    window.pop_front();
+                }
+
+                auto encode = [this, data = std::move(data), encrypt, codec, level]() mutable {
+                    return encodeBlock(std::move(data), encrypt, codec, level);
+                };
+
+                pendingKeys.emplace(key, index);
+                window.push_back({index, std::move(key),
+                    pool ? pool->submit(std::move(encode)) : std::async(std::launch::deferred, std::move(encode))});
+            }
+
+            while (!window.empty()) {
+                writeChunk(window.front());
+                window.pop_front();
+            }
+        } catch (const std::exception& e) {
+            for (auto& pending : window) {
+                if (pending.stored.valid()) {
+                    pending.stored.wait();
+                }
+            }
+            error = "Failed to add " + filepath + ": " + e.what();
+            return false;
+        }
+
+        for (const auto& repeat : repeats) {
+            chunks.chunks[repeat.first].offset = chunks.chunks[repeat.second].offset;
+            chunks.chunks[repeat.first].storedSize = chunks.chunks[repeat.second].storedSize;
+        }
+
+        entry.setOriginalSize(originalSize);
+        entry.setCompressedSize(m_output->position() - dataOffset);
+        entry.setChecksum(hash.finalize());
+        entry.setChunkList(chunks);
+
+        return true;
+    }
+
+    std::vector<uint8_t> Archive::encodeBlock(std::vector<uint8_t> block, bool encrypt, uint8_t codec,
+        int level, const SegmentCipher* stream, uint64_t index, bool last) const {
+        // Same stored order as whole entries: compress, then encrypt
+        if (codec != CodecId::STORE) {
+            CompressionResult result = m_compression->compress(block, codec, level);
+            if (!result.success) {
+                throw std::runtime_error(result.errorMessage);
+            }
+            block = std::move(result.compressedData);
+        }
+
+        if (encrypt && stream) {
+            // The first segment is preceded by the stream header
+            const size_t header = index == 0 ? SegmentCipher::HEADER_SIZE : 0;
+            std::vector<uint8_t> sealed(header + block.size() + SegmentCipher::TAG_SIZE);
+            std::copy(stream->getHeader().begin(), stream->getHeader().begin() + header, sealed.begin());
+            stream->seal(index, last, block.data(), block.size(), sealed.data() + header);
+            block = std::move(sealed);
+        } else if (encrypt) {
+            block = m_crypto->seal(block);
+        }
+
+        return block;
+    }
+
+    void Archive::compressPayload(std::vector<uint8_t>& payload, uint8_t& codec, int level) const {
+        if (codec == CodecId::STORE || payload.empty()) {
+            codec = CodecId::STORE;
+            return;
+        }
+
+        CompressionResult result = m_compression->compress(payload, codec, level);
+        if (!result.success) {
+            throw std::runtime_error(result.errorMessage);
+        }
+
+        if (result.compressedData.size() < payload.size()) {
+            payload = std::move(result.compressedData);
+        } else {
+            codec = CodecId::STORE;
+        }
+    }
+
+    bool Archive::appendEntry(VarcEntry& entry, const std::vector<uint8_t>& payload) {
+        uint32_t pathLength = 0;
+        std::vector<uint8_t> headerData = entry.getEntryHeader(pathLength).serialize();
+
+        if (!m_output->write(headerData) ||
+            !m_output->write(reinterpret_cast<const uint8_t*>(entry.getPath().data()), pathLength)) {
+            m_errorMessage = "Failed to write entry: " + entry.getPath();
+            return false;
+        }
+
+        uint64_t dataOffset = m_output->position();
+
+        if (!m_output->write(payload) || !m_output->write(entry.getChecksum())) {
+            m_errorMessage = "Failed to write entry: " + entry.getPath();
+            return false;
+        }
+
+        entry.setOffset(dataOffset);
+        entry.setStaged(true);
+
+        m_entries.push_back(std::move(entry));
+        m_modified = true;
+
+        return true;
+    }
+
+    bool Archive::processEntry(VarcEntry& entry, const CreateOptions& options) {
+        const auto& data = entry.getData();
+
+        // setData() below describes the processed payload; keep the original's size and checksum
+        const uint64_t originalSize = entry.getOriginalSize();
+        const std::vector<uint8_t> checksum = entry.getChecksum();
+
+        const PolicyDecision encoding = decideEncoding(options, entry.getPath(), entry.getFileType(), originalSize);
+        uint8_t codec = encoding.codec;
+        if (codec != CodecId::STORE && !worthCompressing(data)) {
+            codec = CodecId::STORE;
+        }
+
+        if (codec != CodecId::STORE) {
+            // Compress data, keeping it as-is unless it shrinks
+            CompressionResult result = m_compression->compress(data, codec, encoding.level);
+
+            if (result.success && result.compressedSize < data.size()) {
+                entry.setData(std::move(result.compressedData));
+                entry.setCompressedSize(result.compressedSize);
+                entry.setFlags(entry.getFlags() | codecFlags(codec));
+            }
+        }
+
+        if (options.encrypt && !options.password.empty()) {
+            // Encrypt the (compressed) data
+            initializeEncryption(options.password);
+
+            std::vector<uint8_t> encrypted = m_crypto->seal(entry.getData());
+            entry.setData(std::move(encrypted));
+            entry.setFlags(entry.getFlags() | ENCRYPTED_ENTRY_FLAGS);
+        }
+
+        entry.setOriginalSize(originalSize);
+        entry.setChecksum(checksum);
+
+        m_entries.push_back(std::move(entry));
+        m_modified = true;
+
+        return true;
+    }
+
+    std::vector<uint8_t> Archive::deriveArchiveKey(const std::string& password, const std::vector<uint8_t>& salt,
+        int iterations) {
+        if (m_agentSocket.empty()) {
+            return m_keyCache->deriveKey(password, salt, iterations);
+        }
+        if (password.empty()) {
+            throw std::runtime_error("Password cannot be empty for key derivation");
+        }
+
+        // Local cache, then the agent, then PBKDF2 (the result is handed back to the agent)
+        std::vector<uint8_t> tag = KeyCache::passwordTag(password, salt);
+        std::vector<uint8_t> key;
+        if (!m_keyCache->find(salt, iterations, tag, key)) {
+            if (!KeyAgent::fetch(m_agentSocket, salt, iterations, tag, key)) {
+                key = CryptoEngine::deriveKey(password, salt, iterations);
+                KeyAgent::store(m_agentSocket, salt, iterations, tag, key);
+            }
+            m_keyCache->insert(salt, iterations, tag, key);
+        }
+        CryptoEngine::secureWipe(tag);
+
+        return key;
+    }
+
+    void Archive::initializeEncryption(const std::string& password) {
+        if (m_crypto->isInitialized()) {
+            return;
+        }
+
+        // Entries are encrypted with a random data key, sealed in the first key slot
+        std::vector<uint8_t> key = CryptoEngine::generateRandom(CryptoEngine::AES_KEY_SIZE);
+        std::vector<uint8_t> iv = CryptoEngine::generateIV();
+        for (auto& slot : m_header.keySlots) {
+            slot.clear();
+        }
+        sealKeySlot(m_header.keySlots[0], password, key);
+        m_crypto->initialize(key, iv);
+        CryptoEngine::secureWipe(key);
+
+        // The header salt only derives the key of archives without key slots
+        m_header.salt.fill(0);
+        std::memcpy(m_header.iv.data(), iv.data(), iv.size());
+        m_header.flags |= ArchiveFlags::ENCRYPTED;
+    }
+
+    void Archive::loadEncryptionKey(const std::string& password) {
+        int slot = -1;
+        std::vector<uint8_t> key = unlockDataKey(password, slot);
+        std::vector<uint8_t> iv(m_header.iv.begin(), m_header.iv.end());
+        m_crypto->initialize(key, iv);
+        CryptoEngine::secureWipe(key);
+    }
+
+    std::vector<uint8_t> Archive::unlockDataKey(const std::string& password, int& slot) {
+        // Without key slots, entries are encrypted with the key derived from the header salt
+        if (m_header.activeKeySlots() == 0) {
+            slot = -1;
+            std::vector<uint8_t> salt(m_header.salt.begin(), m_header.salt.end());
+            return deriveArchiveKey(password, salt);
+        }
+
+        for (size_t i = 0; i < KEY_SLOT_COUNT; ++i) {
+            const KeySlot& candidate = m_header.keySlots[i];
+            if (!candidate.isActive() ||
+                candidate.iterations > static_cast<uint32_t>(std::numeric_limits<int>::max())) {
+                continue;
+            }
+
+            // The slot's tag only checks out with the key derived from its password
+            std::vector<uint8_t> salt(candidate.salt.begin(), candidate.salt.end());
+            std::vector<uint8_t> kek = deriveArchiveKey(password, salt, static_cast<int>(candidate.iterations));
+            CryptoEngine wrapper;
+            wrapper.initialize(kek, CryptoEngine::generateIV());
+            CryptoEngine::secureWipe(kek);
+
+            try {
+                std::vector<uint8_t> key = wrapper.unseal(
+                    std::vector<uint8_t>(candidate.wrappedKey.begin(), candidate.wrappedKey.end()));
+                slot = static_cast<int>(i);
+                return key;
+            } catch (const std::exception&) {
+                // Another password's slot
+            }
+        }
+
+        throw std::runtime_error("Incorrect password");
+    }
+
+    void Archive::sealKeySlot(KeySlot& slot, const std::string& password, const std::vector<uint8_t>& key) {
+        std::vector<uint8_t> salt = CryptoEngine::generateSalt(SALT_SIZE);
+        std::vector<uint8_t> kek = deriveArchiveKey(password, salt);
+        CryptoEngine wrapper;
+        wrapper.initialize(kek, CryptoEngine::generateIV());
+        CryptoEngine::secureWipe(kek);
+
+        std::vector<uint8_t> wrapped = wrapper.seal(key);
+        if (wrapped.size() != WRAPPED_KEY_SIZE) {
+            throw std::runtime_error("Invalid data key size");
+        }
+
+        slot.iterations = CryptoEngine::PBKDF2_ITERATIONS;
+        std::copy(salt.begin(), salt.end(), slot.salt.begin());
+        std::copy(wrapped.begin(), wrapped.end(), slot.wrappedKey.begin());
+    }
+
+    void Archive::markKeySlotsModified() {
+        // Format 0.5+ headers hold the slots; older archives are rewritten once to gain them
+        if (m_header.hasKeySlots()) {
+            m_keysModified = true;
+        } else {
+            m_rewrite = true;
+            m_modified = true;
+        }
+    }
+
+    VarcEntry Archive::createEntryFromPath(const std::string& filepath) {
+        std::error_code ec;
+        uint64_t size = std::filesystem::file_size(filepath, ec);
+
+        // Get relative path (strip common prefix if any)
+        std::string relativePath = filepath;
+
+        // Metadata only; the payload is streamed in by streamEntry()
+        VarcEntry entry(relativePath, VarcEntry::Type::FILE, ec ? 0 : size, 0);
+
+        std::chrono::system_clock::time_point modified;
+        if (fileModificationTime(filepath, modified)) {
+            entry.setModificationTime(modified);
+        }
+
+        return entry;
+    }
+
+    void Archive::updateHeader(bool appending) {
+        // An appended archive keeps its header size, and so its format version
+        if (!appending) {
+            m_header.version = (VARC_VERSION_MAJOR << 8) | VARC_VERSION_MINOR;
+        }
         m_header.fileCount = static_cast<uint32_t>(m_entries.size());
 
         if (m_entries.empty()) {
@@ -0,0 +1,77 @@
+/**
+ * @file Chunker.cpp
+ * @brief Content-defined chunking implementation
+ * @author LotusOS Core
+ * @version 1.0.0
+ */
+
+#include "Chunker.hpp"
+#include <array>
+#include <algorithm>
+
+namespace VaultArchive {
+
+    namespace {
+
+        /**
+         * @brief Build the gear table (fixed pseudo-random values)
+         * @return 256 64-bit gear values
+         *
+         * The table is part of the chunk boundary definition: changing it
+         * changes every cut point and defeats deduplication against
+         * existing archives.
+         */
+        std::array<uint64_t, 256> makeGearTable() {
+            std::array<uint64_t, 256> table{};
+            uint64_t state = 0x5641524343444321ULL;  // "VARCCDC!"
+
+            // splitmix64
+            for (auto& value : table) {
+                state += 0x9E3779B97F4A7C15ULL;
+                uint64_t z = state;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                value = z ^ (z >> 31);
+            }
+
+            return table;
+        }
+
+        const std::array<uint64_t, 256> GEAR = makeGearTable();
+
+        // The hash is shifted left, so its top bits depend on the most recent
+        // 64 bytes. Normalized chunking: a stricter mask (more bits) before
+        // the average size and a looser one after it.
+        constexpr uint64_t MASK_SMALL = ~0ULL << (64 - 18);
+        constexpr uint64_t MASK_LARGE = ~0ULL << (64 - 14);
+
+    } // namespace
+
+    size_t Chunker::cut(const uint8_t* data, size_t length) {
+        if (length <= MIN_SIZE) {
+            return length;
+        }
+
+        const size_t normal = std::min(length, AVG_SIZE);
+        const size_t end = std::min(length, MAX_SIZE);
+        uint64_t hash = 0;
+        size_t i = MIN_SIZE;
+
+        for (; i < normal; ++i) {
+            hash = (hash << 1) + GEAR[data[i]];
+            if ((hash & MASK_SMALL) == 0) {
+                return i + 1;
+            }
+        }
+
+        for (; i < end; ++i) {
+            hash = (hash << 1) + GEAR[data[i]];
+            if ((hash & MASK_LARGE) == 0) {
+                return i + 1;
+            }
+        }
+
+        return end;
+    }
+
+} // namespace VaultArchive
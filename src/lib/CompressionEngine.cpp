@@ -13,13 +13,438 @@
 #include <algorithm>
 #include <filesystem>
 #include <array>
-#include <cmath>
 
 // Include zlib header
 #include <zlib.h>
 
+#ifdef VARC_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef VARC_HAVE_LZ4
+#include <lz4.h>
+#endif
+
 namespace VaultArchive {
 
+    namespace {
+
+        constexpr int GZIP_WINDOW_BITS = 15 + 16;  // 32 KiB window with gzip wrapper
+
+        /**
+         * @brief zlib DEFLATE with gzip wrapper
+         */
+        class DeflateCodec : public Codec {
+        public:
+            uint8_t id() const override { return CodecId::DEFLATE; }
+            std::string name() const override { return "deflate"; }
+
+            bool compress(const uint8_t* data, size_t length, int level,
+                std::vector<uint8_t>& output, std::string& error) const override {
+                ZlibStream stream(ZlibStream::Mode::DEFLATE, GZIP_WINDOW_BITS, level);
+                if (!stream.valid()) {
+                    error = "Failed to initialize compression";
+                    return false;
+                }
+                z_stream& strm = stream.get();
+
+                // Allocate output buffer (worst case: slightly larger than input)
+                output.resize(deflateBound(&strm, static_cast<uLong>(length)));
+
+                strm.next_in = const_cast<unsigned char*>(data);
+                strm.avail_in = static_cast<uInt>(length);
+                strm.next_out = output.data();
+                strm.avail_out = static_cast<uInt>(output.size());
+
+                int ret = deflate(&strm, Z_FINISH);
+                output.resize(strm.total_out);
+
+                if (ret != Z_STREAM_END) {
+                    error = "Compression failed";
+                    return false;
+                }
+                return true;
+            }
+
+            bool decompress(const uint8_t* data, size_t length, size_t originalSize,
+                std::vector<uint8_t>& output, std::string& error) const override {
+                ZlibStream stream(ZlibStream::Mode::INFLATE, GZIP_WINDOW_BITS);
+                if (!stream.valid()) {
+                    error = "Failed to initialize decompression";
+                    return false;
+                }
+                z_stream& strm = stream.get();
+
+                // If the size is known, allocate the exact buffer; otherwise start
+                // at twice the compressed size and grow
+                size_t bufferSize = std::max(originalSize, length * 2);
+                output.resize(bufferSize);
+
+                strm.next_in = const_cast<unsigned char*>(data);
+                strm.avail_in = static_cast<uInt>(length);
+
+                int ret;
+                do {
+                    strm.next_out = output.data() + strm.total_out;
+                    strm.avail_out = static_cast<uInt>(bufferSize - strm.total_out);
+
+                    ret = inflate(&strm, Z_NO_FLUSH);
+
+                    if (ret == Z_STREAM_ERROR || ret == Z_DATA_ERROR || ret == Z_NEED_DICT || ret == Z_MEM_ERROR) {
+                        error = "Decompression failed: " + std::string(strm.msg ? strm.msg : "invalid data");
+                        return false;
+                    }
+
+                    // Input ended before the stream did
+                    if (ret == Z_BUF_ERROR && strm.avail_in == 0) {
+                        error = "Unexpected end of compressed data";
+                        return false;
+                    }
+
+                    // Grow buffer if needed
+                    if (ret != Z_STREAM_END && strm.avail_out == 0) {
+                        bufferSize *= 2;
+                        output.resize(bufferSize);
+                    }
+                } while (ret != Z_STREAM_END);
+
+                output.resize(strm.total_out);
+                return true;
+            }
+        };
+
+        /**
+         * @brief Data stored as-is
+         */
+        class StoreCodec : public Codec {
+        public:
+            uint8_t id() const override { return CodecId::STORE; }
+            std::string name() const override { return "store"; }
+
+            bool compress(const uint8_t* data, size_t length, int,
+                std::vector<uint8_t>& output, std::string&) const override {
+                output.assign(data, data + length);
+                return true;
+            }
+
+            bool decompress(const uint8_t* data, size_t length, size_t,
+                std::vector<uint8_t>& output, std::string&) const override {
+                output.assign(data, data + length);
+                return true;
+            }
+        };
+
+#ifdef VARC_HAVE_ZSTD
+        /**
+         * @brief Zstandard (single frame, content size recorded)
+         */
+        class ZstdCodec : public Codec {
+        public:
+            uint8_t id() const override { return CodecId::ZSTD; }
+            std::string name() const override { return "zstd"; }
+
+            bool compress(const uint8_t* data, size_t length, int level,
+                std::vector<uint8_t>& output, std::string& error) const override {
+                // Default level 6 maps to zstd's default of 3; 9 to its strong end
+                int zstdLevel = level >= CompressionLevel::BEST ? 19 : level >= CompressionLevel::DEFAULT ? 3 : 1;
+
+                output.resize(ZSTD_compressBound(length));
+                size_t written = ZSTD_compress(output.data(), output.size(), data, length, zstdLevel);
+                if (ZSTD_isError(written)) {
+                    error = std::string("Compression failed: ") + ZSTD_getErrorName(written);
+                    return false;
+                }
+                output.resize(written);
+                return true;
+            }
+
+            bool decompress(const uint8_t* data, size_t length, size_t originalSize,
+                std::vector<uint8_t>& output, std::string& error) const override {
+                if (originalSize == 0) {
+                    unsigned long long frameSize = ZSTD_getFrameContentSize(data, length);
+                    if (frameSize == ZSTD_CONTENTSIZE_UNKNOWN || frameSize == ZSTD_CONTENTSIZE_ERROR) {
+                        error = "Decompression failed: unknown content size";
+                        return false;
+                    }
+                    originalSize = static_cast<size_t>(frameSize);
+                }
+
+                output.resize(originalSize);
+                size_t written = ZSTD_decompress(output.data(), output.size(), data, length);
+                if (ZSTD_isError(written)) {
+                    error = std::string("Decompression failed: ") + ZSTD_getErrorName(written);
+                    return false;
+                }
+                output.resize(written);
+                return true;
+            }
+        };
+#endif
+
+#ifdef VARC_HAVE_LZ4
+        /**
+         * @brief LZ4 block format (the entry records the original size)
+         */
+        class Lz4Codec : public Codec {
+        public:
+            uint8_t id() const override { return CodecId::LZ4; }
+            std::string name() const override { return "lz4"; }
+
+            bool compress(const uint8_t* data, size_t length, int,
+                std::vector<uint8_t>& output, std::string& error) const override {
+                if (length > static_cast<size_t>(LZ4_MAX_INPUT_SIZE)) {
+                    error = "Compression failed: input too large for LZ4";
+                    return false;
+                }
+
+                output.resize(static_cast<size_t>(LZ4_compressBound(static_cast<int>(length))));
+                int written = LZ4_compress_default(reinterpret_cast<const char*>(data),
+                    reinterpret_cast<char*>(output.data()), static_cast<int>(length), static_cast<int>(output.size()));
+                if (written <= 0) {
+                    error = "Compression failed";
+                    return false;
+                }
+                output.resize(static_cast<size_t>(written));
+                return true;
+            }
+
+            bool decompress(const uint8_t* data, size_t length, size_t originalSize,
+                std::vector<uint8_t>& output, std::string& error) const override {
+                if (originalSize == 0 || originalSize > static_cast<size_t>(LZ4_MAX_INPUT_SIZE) ||
+                    length > static_cast<size_t>(LZ4_MAX_INPUT_SIZE)) {
+                    error = "Decompression failed: invalid LZ4 block size";
+                    return false;
+                }
+
+                output.resize(originalSize);
+                int written = LZ4_decompress_safe(reinterpret_cast<const char*>(data),
+                    reinterpret_cast<char*>(output.data()), static_cast<int>(length), static_cast<int>(originalSize));
+                if (written < 0) {
+                    error = "Decompression failed: corrupt LZ4 block";
+                    return false;
+                }
+                output.resize(static_cast<size_t>(written));
+                return true;
+            }
+        };
+#endif
+
+        /**
+         * @brief Get the bytes sampled per probe window
+         * @param size Data size
+         * @return Window length (the whole data if it fits in SAMPLE_WINDOWS windows)
+         */
+        uint64_t sampleLength(uint64_t size) {
+            const uint64_t sampleTotal = CompressionEngine::SAMPLE_WINDOWS * CompressionEngine::SAMPLE_WINDOW_SIZE;
+            return size <= sampleTotal ? size : CompressionEngine::SAMPLE_WINDOW_SIZE;
+        }
+
+        /**
+         * @brief Get the offsets of the probe windows, spread evenly from start to end
+         * @param size Data size
+         * @return Window offsets
+         */
+        std::vector<uint64_t> sampleOffsets(uint64_t size) {
+            const uint64_t window = sampleLength(size);
+            if (window == size) {
+                return {0};
+            }
+
+            std::vector<uint64_t> offsets;
+            const uint64_t last = size - window;
+            for (size_t i = 0; i < CompressionEngine::SAMPLE_WINDOWS; ++i) {
+                offsets.push_back(last * i / (CompressionEngine::SAMPLE_WINDOWS - 1));
+            }
+            return offsets;
+        }
+
+        /**
+         * @brief Compress a sample at the fastest level without a wrapper
+         * @param data Sample
+         * @param length Sample length
+         * @return Compressed size (length if compression fails)
+         */
+        size_t trialCompress(const uint8_t* data, size_t length) {
+            if (length == 0) {
+                return length;
+            }
+
+            ZlibStream stream(ZlibStream::Mode::DEFLATE, -15, CompressionLevel::FASTEST);
+            if (!stream.valid()) {
+                return length;
+            }
+
+            z_stream& strm = stream.get();
+            std::vector<uint8_t>& output = stream.output(deflateBound(&strm, static_cast<uLong>(length)));
+            strm.next_in = const_cast<unsigned char*>(data);
+            strm.avail_in = static_cast<uInt>(length);
+            strm.next_out = output.data();
+            strm.avail_out = static_cast<uInt>(output.size());
+
+            int ret = deflate(&strm, Z_FINISH);
+            return ret == Z_STREAM_END ? static_cast<size_t>(strm.total_out) : length;
+        }
+
+        /**
+         * @brief Get the registered codecs, indexed by id
+         * @return Codec table
+         */
+        std::array<std::unique_ptr<Codec>, CodecId::MAX + 1>& codecTable() {
+            static std::array<std::unique_ptr<Codec>, CodecId::MAX + 1> codecs = []() {
+                std::array<std::unique_ptr<Codec>, CodecId::MAX + 1> table;
+                table[CodecId::DEFLATE] = std::make_unique<DeflateCodec>();
+                table[CodecId::STORE] = std::make_unique<StoreCodec>();
+#ifdef VARC_HAVE_ZSTD
+                table[CodecId::ZSTD] = std::make_unique<ZstdCodec>();
+#endif
+#ifdef VARC_HAVE_LZ4
+                table[CodecId::LZ4] = std::make_unique<Lz4Codec>();
+#endif
+                return table;
+            }();
+            return codecs;
+        }
+
+    } // namespace
+
+    // ======================
+    // CodecRegistry Implementation
+    // ======================
+
+    const Codec* CodecRegistry::find(uint8_t id) {
+        return id <= CodecId::MAX ? codecTable()[id].get() : nullptr;
+    }
+
+    const Codec* CodecRegistry::find(const std::string& name) {
+        for (const auto& codec : codecTable()) {
+            if (codec && codec->name() == name) {
+                return codec.get();
+            }
+        }
+        return nullptr;
+    }
+
+    bool CodecRegistry::add(std::unique_ptr<Codec> codec) {
+        if (!codec || codec->id() > CodecId::MAX || codecTable()[codec->id()] || find(codec->name())) {
+            return false;
+        }
+        codecTable()[codec->id()] = std::move(codec);
+        return true;
+    }
+
+    std::vector<std::string> CodecRegistry::names() {
+        std::vector<std::string> result;
+        for (const auto& codec : codecTable()) {
+            if (codec) {
+                result.push_back(codec->name());
+            }
+        }
+        return result;
+    }
+
+    // ======================
+    // ZlibStream Implementation
+    // ======================
+
+    struct ZlibStream::Context {
+        z_stream strm;
+        Mode mode;
+        int windowBits;
+        int level;
+        bool ready = false;
+        std::vector<uint8_t> input;
+        std::vector<uint8_t> output;
+
+        Context(Mode streamMode, int bits, int streamLevel)
+            : strm(), mode(streamMode), windowBits(bits), level(streamLevel) {
+            ready = mode == Mode::DEFLATE
+                ? deflateInit2(&strm, level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) == Z_OK
+                : inflateInit2(&strm, windowBits) == Z_OK;
+        }
+
+        ~Context() {
+            if (ready) {
+                mode == Mode::DEFLATE ? deflateEnd(&strm) : inflateEnd(&strm);
+            }
+        }
+
+        /**
+         * @brief Reset for new input
+         * @param streamLevel Compression level for the next stream
+         * @return true if the stream can be used
+         */
+        bool reset(int streamLevel) {
+            if (mode == Mode::INFLATE) {
+                return inflateReset(&strm) == Z_OK;
+            }
+            if (deflateReset(&strm) != Z_OK) {
+                return false;
+            }
+            if (streamLevel != level) {
+                if (deflateParams(&strm, streamLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+                    return false;
+                }
+                level = streamLevel;
+            }
+            return true;
+        }
+    };
+
+    ZlibStream::ZlibStream(Mode mode, int windowBits, int level) {
+        std::vector<std::unique_ptr<Context>>& idle = idleStreams();
+
+        auto match = std::find_if(idle.rbegin(), idle.rend(), [&](const std::unique_ptr<Context>& context) {
+            return context->mode == mode && context->windowBits == windowBits;
+        });
+        if (match != idle.rend()) {
+            std::unique_ptr<Context> context = std::move(*match);
+            idle.erase(std::next(match).base());
+            if (context->reset(level)) {
+                m_context = std::move(context);
+                return;
+            }
+        }
+
+        auto context = std::make_unique<Context>(mode, windowBits, level);
+        if (context->ready) {
+            m_context = std::move(context);
+        }
+    }
+
+    ZlibStream::~ZlibStream() {
+        std::vector<std::unique_ptr<Context>>& idle = idleStreams();
+        if (m_context && idle.size() < MAX_IDLE_STREAMS) {
+            idle.push_back(std::move(m_context));
+        }
+    }
+
+    bool ZlibStream::valid() const {
+        return m_context != nullptr;
+    }
+
+    z_stream& ZlibStream::get() {
+        return m_context->strm;
+    }
+
+    std::vector<uint8_t>& ZlibStream::input(size_t size) {
+        if (m_context->input.size() < size) {
+            m_context->input.resize(size);
+        }
+        return m_context->input;
+    }
+
+    std::vector<uint8_t>& ZlibStream::output(size_t size) {
+        if (m_context->output.size() < size) {
+            m_context->output.resize(size);
+        }
+        return m_context->output;
+    }
+
+    std::vector<std::unique_ptr<ZlibStream::Context>>& ZlibStream::idleStreams() {
+        thread_local std::vector<std::unique_ptr<Context>> idle;
+        return idle;
+    }
+
     // ======================
     // CompressionEngine Implementation
     // ======================
@@ -51,6 +476,14 @@ namespace VaultArchive {
     }
 
     CompressionResult CompressionEngine::compress(const std::vector<uint8_t>& data) {
+        return compress(data, CodecId::DEFLATE);
+    }
+
+    CompressionResult CompressionEngine::compress(const std::vector<uint8_t>& data, uint8_t codec) {
+        return compress(data, codec, m_compressionLevel);
+    }
+
+    CompressionResult CompressionEngine::compress(const std::vector<uint8_t>& data, uint8_t codec, int level) const {
         CompressionResult result;
         result.success = false;
         result.originalSize = data.size();
@@ -63,54 +496,25 @@ namespace VaultArchive {
             return result;
         }
 
-        // Initialize zlib stream
-        z_stream strm;
-        strm.zalloc = Z_NULL;
-        strm.zfree = Z_NULL;
-        strm.opaque = Z_NULL;
-
-        int ret = deflateInit2(
-            &strm,
-            m_compressionLevel,
-            Z_DEFLATED,
-            m_windowBits,
-            8,
-            Z_DEFAULT_STRATEGY
-        );
-
-        if (ret != Z_OK) {
-            result.errorMessage = "Failed to initialize compression";
+        const Codec* implementation = CodecRegistry::find(codec);
+        if (!implementation) {
+            result.errorMessage = "Codec not available: " + std::to_string(codec);
             return result;
         }
 
-        // Allocate output buffer (worst case: slightly larger than input)
-        uLongf bufferSize = deflateBound(&strm, data.size());
-        result.compressedData.resize(bufferSize);
-
-        strm.next_in = const_cast<unsigned char*>(data.data());
-        strm.avail_in = static_cast<uInt>(data.size());
-
-        strm.next_out = result.compressedData.data();
-        strm.avail_out = bufferSize;
-
-        // Compress
-        ret = deflate(&strm, Z_FINISH);
-
-        if (ret != Z_STREAM_END) {
-            result.errorMessage = "Compression failed";
-            deflateEnd(&strm);
+        if (!implementation->compress(data.data(), data.size(), std::max(0, std::min(9, level)),
+                result.compressedData, result.errorMessage)) {
+            result.compressedData.clear();
             return result;
         }
 
-        result.compressedSize = strm.total_out;
-        result.compressedData.resize(result.compressedSize);
+        result.compressedSize = result.compressedData.size();
         result.success = true;
 
         if (result.originalSize > 0) {
             result.compressionRatio = (100.0 * result.compressedSize) / result.originalSize;
         }
 
-        deflateEnd(&strm);
         return result;
     }
 
@@ -143,6 +547,14 @@ namespace VaultArchive {
     DecompressionResult CompressionEngine::decompress(
         const std::vector<uint8_t>& compressedData,
         uint64_t expectedSize
+    ) {
+        return decompress(compressedData, expectedSize, CodecId::DEFLATE);
+    }
+
+    DecompressionResult CompressionEngine::decompress(
+        const std::vector<uint8_t>& compressedData,
+        uint64_t expectedSize,
+        uint8_t codec
     ) {
         DecompressionResult result;
         result.success = false;
@@ -154,64 +566,20 @@ namespace VaultArchive {
             return result;
         }
 
-        // Initialize zlib stream
-        z_stream strm;
-        strm.zalloc = Z_NULL;
-        strm.zfree = Z_NULL;
-        strm.opaque = Z_NULL;
-
-        int ret = inflateInit2(&strm, m_windowBits);
-
-        if (ret != Z_OK) {
-            result.errorMessage = "Failed to initialize decompression";
+        const Codec* implementation = CodecRegistry::find(codec);
+        if (!implementation) {
+            result.errorMessage = "Codec not available: " + std::to_string(codec);
             return result;
         }
 
-        // If expected size is known, allocate exact buffer
-        // Otherwise, start with compressed size (decompressed is usually larger)
-        uLongf bufferSize = expectedSize > 0 ?
-            static_cast<uLongf>(expectedSize) :
-            static_cast<uLongf>(compressedData.size() * 2);
-
-        if (bufferSize < compressedData.size()) {
-            bufferSize = static_cast<uLongf>(compressedData.size() * 2);
+        if (!implementation->decompress(compressedData.data(), compressedData.size(),
+                static_cast<size_t>(expectedSize), result.decompressedData, result.errorMessage)) {
+            result.decompressedData.clear();
+            return result;
         }
 
-        result.decompressedData.resize(bufferSize);
-
-        strm.next_in = const_cast<unsigned char*>(compressedData.data());
-        strm.avail_in = static_cast<uInt>(compressedData.size());
-
-        // Decompress
-        std::vector<uint8_t> output;
-        int ret2;
-
-        do {
-            strm.next_out = result.decompressedData.data() + result.decompressedSize;
-            strm.avail_out = bufferSize - result.decompressedSize;
-
-            ret2 = inflate(&strm, Z_NO_FLUSH);
-
-            if (ret2 == Z_STREAM_ERROR || ret2 == Z_DATA_ERROR) {
-                result.errorMessage = "Decompression failed: " + std::string(strm.msg);
-                inflateEnd(&strm);
-                return result;
-            }
-
-            result.decompressedSize = strm.total_out;
-
-            // Grow buffer if needed
-            if (ret2 != Z_STREAM_END && strm.avail_out == 0) {
-                bufferSize *= 2;
-                result.decompressedData.resize(bufferSize);
-            }
-
-        } while (ret2 != Z_STREAM_END);
-
-        result.decompressedData.resize(result.decompressedSize);
+        result.decompressedSize = result.decompressedData.size();
         result.success = true;
-
-        inflateEnd(&strm);
         return result;
     }
 
@@ -333,37 +701,55 @@ namespace VaultArchive {
     }
 
     double CompressionEngine::estimateCompressionRatio(const std::vector<uint8_t>& data) {
-        if (data.empty()) {
-            return 100.0;  // Empty data compresses to nothing
+        return estimateCompressionRatio(data.data(), data.size());
+    }
+
+    double CompressionEngine::estimateCompressionRatio(const uint8_t* data, size_t length) {
+        if (length == 0) {
+            return 100.0;  // Nothing to gain
         }
 
-        // Heuristic based on data characteristics
-        size_t uniqueBytes = 0;
-        std::array<bool, 256> seen{};
-        seen.fill(false);
+        size_t sampled = 0;
+        size_t compressed = 0;
+        for (uint64_t offset : sampleOffsets(length)) {
+            size_t window = static_cast<size_t>(std::min<uint64_t>(length - offset, sampleLength(length)));
+            compressed += trialCompress(data + offset, window);
+            sampled += window;
+        }
 
-        for (uint8_t byte : data) {
-            if (!seen[byte]) {
-                seen[byte] = true;
-                uniqueBytes++;
-            }
+        return (100.0 * compressed) / sampled;
+    }
+
+    double CompressionEngine::estimateCompressionRatio(std::istream& input, uint64_t size) {
+        if (size == 0) {
+            return 100.0;
         }
 
-        // Calculate entropy (simplified)
-        double entropy = 0.0;
-        for (bool present : seen) {
-            if (present) {
-                double p = static_cast<double>(uniqueBytes) / 256.0;
-                entropy -= p * std::log2(p);
-            }
+        std::istream::pos_type position = input.tellg();
+        if (position == std::istream::pos_type(-1)) {
+            return 0.0;
+        }
+
+        std::vector<uint8_t> window(static_cast<size_t>(sampleLength(size)));
+        size_t sampled = 0;
+        size_t compressed = 0;
+
+        for (uint64_t offset : sampleOffsets(size)) {
+            input.seekg(static_cast<std::streamoff>(offset));
+            input.read(reinterpret_cast<char*>(window.data()), static_cast<std::streamsize>(window.size()));
+            size_t length = static_cast<size_t>(input.gcount());
+            input.clear();
+
+            compressed += trialCompress(window.data(), length);
+            sampled += length;
         }
 
-        // Estimate compression ratio based on entropy
-        // High entropy = low compressibility (ratio close to 100%)
-        // Low entropy = high compressibility (ratio much less than 100%)
-        double estimatedRatio = entropy * 100.0 / 8.0;  // 8 bits per byte
+        input.seekg(position);
+        if (!input || sampled == 0) {
+            return 0.0;
+        }
 
-        return std::min(100.0, estimatedRatio);
+        return (100.0 * compressed) / sampled;
     }
 
     int CompressionEngine::getOptimalLevel(uint32_t dataType) {
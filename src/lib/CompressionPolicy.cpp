@@ -0,0 +1,329 @@
+/**
+ * @file CompressionPolicy.cpp
+ * @brief Per-entry compression rules implementation
+ * @author LotusOS Core
+ * @version 1.0.0
+ */
+
+#include "CompressionPolicy.hpp"
+#include "CompressionEngine.hpp"
+#include "VarcHeader.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+namespace VaultArchive {
+
+    namespace {
+
+        // File type names accepted in type= matches
+        const std::array<std::pair<const char*, uint32_t>, 8> TYPE_NAMES = {{
+            {"unknown", FileType::UNKNOWN},
+            {"text", FileType::TEXT},
+            {"binary", FileType::BINARY},
+            {"image", FileType::IMAGE},
+            {"audio", FileType::AUDIO},
+            {"video", FileType::VIDEO},
+            {"document", FileType::DOCUMENT},
+            {"archive", FileType::ARCHIVE}
+        }};
+
+        std::string toLower(std::string text) {
+            std::transform(text.begin(), text.end(), text.begin(),
+                [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return text;
+        }
+
+        std::vector<std::string> splitList(const std::string& text) {
+            std::vector<std::string> items;
+            std::stringstream stream(text);
+            std::string item;
+            while (std::getline(stream, item, ',')) {
+                if (!item.empty()) {
+                    items.push_back(item);
+                }
+            }
+            return items;
+        }
+
+        /**
+         * @brief Parse a size with an optional K, M or G suffix (binary units)
+         * @param text Size text
+         * @param size Parsed size
+         * @return true if valid
+         */
+        bool parseSize(const std::string& text, uint64_t& size) {
+            if (text.empty() || !std::isdigit(static_cast<unsigned char>(text[0]))) {
+                return false;
+            }
+
+            size_t end = 0;
+            unsigned long long value = 0;
+            try {
+                value = std::stoull(text, &end);
+            } catch (...) {
+                return false;
+            }
+
+            std::string suffix = toLower(text.substr(end));
+            int shift = 0;
+            if (suffix == "k" || suffix == "kb" || suffix == "kib") {
+                shift = 10;
+            } else if (suffix == "m" || suffix == "mb" || suffix == "mib") {
+                shift = 20;
+            } else if (suffix == "g" || suffix == "gb" || suffix == "gib") {
+                shift = 30;
+            } else if (!suffix.empty()) {
+                return false;
+            }
+
+            if (value > (std::numeric_limits<uint64_t>::max() >> shift)) {
+                return false;
+            }
+            size = static_cast<uint64_t>(value) << shift;
+            return true;
+        }
+
+        /**
+         * @brief Get the lower-case extension of a path, including the dot
+         * @param path File path
+         * @return Extension (empty if the file name has none)
+         */
+        std::string extensionOf(const std::string& path) {
+            size_t name = path.find_last_of("/\\");
+            name = name == std::string::npos ? 0 : name + 1;
+            size_t dot = path.find_last_of('.');
+            if (dot == std::string::npos || dot <= name) {
+                return std::string();
+            }
+            return toLower(path.substr(dot));
+        }
+
+    } // namespace
+
+    // ======================
+    // PolicyRule Implementation
+    // ======================
+
+    bool PolicyRule::parse(const std::string& text, PolicyRule& rule, std::string& error) {
+        rule = PolicyRule();
+
+        // Tokens are kept as written, separated by single spaces, to name the rule
+        std::stringstream stream(text);
+        std::string token;
+        std::vector<std::string> tokens;
+        while (stream >> token) {
+            rule.text += (tokens.empty() ? "" : " ") + token;
+            tokens.push_back(token);
+        }
+
+        bool hasAction = false;
+        for (const auto& part : tokens) {
+            std::string lower = toLower(part);
+
+            if (lower.compare(0, 5, "type=") == 0) {
+                for (const auto& name : splitList(lower.substr(5))) {
+                    auto type = std::find_if(TYPE_NAMES.begin(), TYPE_NAMES.end(),
+                        [&name](const std::pair<const char*, uint32_t>& entry) { return name == entry.first; });
+                    if (type == TYPE_NAMES.end()) {
+                        error = "Unknown file type: " + name;
+                        return false;
+                    }
+                    rule.fileTypes.push_back(type->second);
+                }
+            } else if (lower.compare(0, 4, "ext=") == 0) {
+                for (auto extension : splitList(lower.substr(4))) {
+                    rule.extensions.push_back(extension[0] == '.' ? extension : "." + extension);
+                }
+            } else if (lower.compare(0, 4, "size") == 0) {
+                std::string comparison = lower.substr(4);
+                char op = comparison.empty() ? '\0' : comparison[0];
+                bool orEqual = comparison.size() > 1 && comparison[1] == '=';
+                uint64_t size = 0;
+                bool valid = (op == '<' || op == '>') && parseSize(comparison.substr(orEqual ? 2 : 1), size);
+
+                // Bounds are kept inclusive
+                if (valid && op == '<') {
+                    valid = orEqual || size > 0;
+                    rule.maxSize = std::min(rule.maxSize, orEqual ? size : size - 1);
+                } else if (valid) {
+                    valid = orEqual || size < std::numeric_limits<uint64_t>::max();
+                    rule.minSize = std::max(rule.minSize, orEqual ? size : size + 1);
+                }
+                if (!valid) {
+                    error = "Invalid size match: " + part;
+                    return false;
+                }
+            } else if (lower == "store") {
+                rule.codec = CodecId::STORE;
+                hasAction = true;
+            } else if (lower.compare(0, 6, "codec=") == 0) {
+                const Codec* codec = CodecRegistry::find(lower.substr(6));
+                if (!codec) {
+                    error = "Unknown or unavailable codec: " + lower.substr(6);
+                    return false;
+                }
+                rule.codec = codec->id();
+                hasAction = true;
+            } else if (lower.compare(0, 6, "level=") == 0) {
+                std::string level = lower.substr(6);
+                if (level.size() != 1 || !std::isdigit(static_cast<unsigned char>(level[0]))) {
+                    error = "Invalid level (0-9): " + part;
+                    return false;
+                }
+                rule.level = level[0] - '0';
+                hasAction = true;
+            } else if (lower == "solid") {
+                rule.solid = true;
+                hasAction = true;
+            } else {
+                error = "Unknown rule token: " + part;
+                return false;
+            }
+        }
+
+        if (!hasAction) {
+            error = "Rule has no action (store, codec=, level= or solid): " + rule.text;
+            return false;
+        }
+
+        // Solid blocks are encoded with the archive-wide codec and level
+        if (rule.solid && (rule.codec >= 0 || rule.level >= 0)) {
+            error = "solid cannot be combined with store, codec= or level=: " + rule.text;
+            return false;
+        }
+
+        if (rule.minSize > rule.maxSize) {
+            error = "Size range matches no file: " + rule.text;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool PolicyRule::matches(const std::string& path, uint32_t fileType, uint64_t size) const {
+        if (size < minSize || size > maxSize) {
+            return false;
+        }
+
+        if (!fileTypes.empty() && std::find(fileTypes.begin(), fileTypes.end(), fileType) == fileTypes.end()) {
+            return false;
+        }
+
+        if (!extensions.empty() &&
+            std::find(extensions.begin(), extensions.end(), extensionOf(path)) == extensions.end()) {
+            return false;
+        }
+
+        return true;
+    }
+
+    // ======================
+    // CompressionPolicy Implementation
+    // ======================
+
+    bool CompressionPolicy::empty() const {
+        return m_rules.empty();
+    }
+
+    const std::vector<PolicyRule>& CompressionPolicy::getRules() const {
+        return m_rules;
+    }
+
+    void CompressionPolicy::addRule(const PolicyRule& rule) {
+        m_rules.push_back(rule);
+    }
+
+    bool CompressionPolicy::addRule(const std::string& text, std::string& error) {
+        PolicyRule rule;
+        if (!PolicyRule::parse(text, rule, error)) {
+            return false;
+        }
+        m_rules.push_back(std::move(rule));
+        return true;
+    }
+
+    bool CompressionPolicy::load(const std::string& path, std::string& error) {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            error = "Cannot open policy file: " + path;
+            return false;
+        }
+
+        std::string line;
+        size_t lineNumber = 0;
+        while (std::getline(file, line)) {
+            ++lineNumber;
+
+            size_t comment = line.find('#');
+            if (comment != std::string::npos) {
+                line.erase(comment);
+            }
+            if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                continue;
+            }
+
+            std::string ruleError;
+            if (!addRule(line, ruleError)) {
+                error = path + ":" + std::to_string(lineNumber) + ": " + ruleError;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool CompressionPolicy::usesFileTypes() const {
+        return std::any_of(m_rules.begin(), m_rules.end(),
+            [](const PolicyRule& rule) { return !rule.fileTypes.empty(); });
+    }
+
+    bool CompressionPolicy::usesSolid() const {
+        return std::any_of(m_rules.begin(), m_rules.end(),
+            [](const PolicyRule& rule) { return rule.solid; });
+    }
+
+    PolicyDecision CompressionPolicy::decide(const std::string& path, uint32_t fileType, uint64_t size,
+        const PolicyDecision& defaults) const {
+        PolicyDecision decision = defaults;
+
+        for (const auto& rule : m_rules) {
+            if (!rule.matches(path, fileType, size)) {
+                continue;
+            }
+
+            if (rule.codec >= 0) {
+                decision.codec = static_cast<uint8_t>(rule.codec);
+            }
+            if (rule.level >= 0) {
+                decision.level = rule.level;
+            }
+            decision.solid = rule.solid;
+            decision.rule = rule.text;
+            break;
+        }
+
+        return decision;
+    }
+
+    CompressionPolicy CompressionPolicy::defaults() {
+        static const char* const RULES[] = {
+            "type=image,audio,video,archive store",
+            "ext=.jpg,.jpeg,.png,.gif,.webp,.heic,.mp3,.m4a,.aac,.ogg,.opus,.flac,"
+                ".mp4,.m4v,.mkv,.mov,.avi,.webm,.zip,.gz,.tgz,.bz2,.xz,.zst,.lz4,.7z,.rar store",
+            "size<=16K solid",
+            "type=text,document level=9"
+        };
+
+        CompressionPolicy policy;
+        std::string error;
+        for (const char* text : RULES) {
+            policy.addRule(text, error);
+        }
+        return policy;
+    }
+
+} // namespace VaultArchive
@@ -12,20 +12,104 @@
 #include <openssl/err.h>
 #include <openssl/sha.h>
 #include <openssl/hmac.h>
+#include <openssl/crypto.h>
 #include <stdexcept>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <memory>
 #include <cstring>
+#include <algorithm>
+#include <limits>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
 
 namespace VaultArchive {
 
+    namespace {
+
+        /**
+         * @brief Get the steady clock in whole seconds (never 0, which marks "no expiry")
+         * @return Seconds
+         */
+        int64_t steadySeconds() {
+            return std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count() + 1;
+        }
+
+        using CipherContext = std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)>;
+
+        /**
+         * @brief Encrypt with AES-256-GCM
+         * @param key Key (AES_KEY_SIZE bytes)
+         * @param nonce Nonce (GCM_NONCE_SIZE bytes)
+         * @param input Plaintext
+         * @param length Plaintext length
+         * @param output Ciphertext (length bytes; GCM adds no padding)
+         * @param tag Tag (GCM_TAG_SIZE bytes)
+         * @throws std::runtime_error on failure
+         */
+        void gcmEncrypt(const uint8_t* key, const uint8_t* nonce, const uint8_t* input, size_t length,
+            uint8_t* output, uint8_t* tag) {
+            if (length > static_cast<size_t>(std::numeric_limits<int>::max())) {
+                throw std::runtime_error("Data too large for authenticated encryption");
+            }
+
+            CipherContext ctx(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
+            int outLen = 0;
+            if (!ctx ||
+                EVP_EncryptInit_ex(ctx.get(), EVP_aes_256_gcm(), nullptr, key, nonce) != 1 ||
+                EVP_EncryptUpdate(ctx.get(), output, &outLen, input, static_cast<int>(length)) != 1 ||
+                EVP_EncryptFinal_ex(ctx.get(), output + outLen, &outLen) != 1 ||
+                EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_GET_TAG,
+                    static_cast<int>(CryptoEngine::GCM_TAG_SIZE), tag) != 1) {
+                throw std::runtime_error("Authenticated encryption failed");
+            }
+        }
+
+        /**
+         * @brief Decrypt and authenticate with AES-256-GCM
+         * @param key Key (AES_KEY_SIZE bytes)
+         * @param nonce Nonce (GCM_NONCE_SIZE bytes)
+         * @param input Ciphertext
+         * @param length Ciphertext length
+         * @param tag Expected tag (GCM_TAG_SIZE bytes)
+         * @param output Plaintext (length bytes)
+         * @throws std::runtime_error if the tag does not match
+         */
+        void gcmDecrypt(const uint8_t* key, const uint8_t* nonce, const uint8_t* input, size_t length,
+            const uint8_t* tag, uint8_t* output) {
+            if (length > static_cast<size_t>(std::numeric_limits<int>::max())) {
+                throw std::runtime_error("Data too large for authenticated decryption");
+            }
+
+            CipherContext ctx(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
+            int outLen = 0;
+            if (!ctx ||
+                EVP_DecryptInit_ex(ctx.get(), EVP_aes_256_gcm(), nullptr, key, nonce) != 1 ||
+                EVP_DecryptUpdate(ctx.get(), output, &outLen, input, static_cast<int>(length)) != 1 ||
+                EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_TAG, static_cast<int>(CryptoEngine::GCM_TAG_SIZE),
+                    const_cast<uint8_t*>(tag)) != 1) {
+                throw std::runtime_error("Failed to initialize authenticated decryption");
+            }
+
+            if (EVP_DecryptFinal_ex(ctx.get(), output + outLen, &outLen) != 1) {
+                OPENSSL_cleanse(output, length);
+                throw std::runtime_error("Authentication failed - data has been tampered with or wrong password");
+            }
+        }
+
+    } // namespace
+
     // ======================
     // CryptoEngine Implementation
     // ======================
 
-    CryptoEngine::CryptoEngine() : m_initialized(false) {
+    CryptoEngine::CryptoEngine() : m_initialized(false), m_noncePrefix(), m_nonceCounter(0) {
     }
 
     CryptoEngine::~CryptoEngine() {
@@ -42,15 +126,25 @@ namespace VaultArchive {
 
         m_key = key;
         m_iv = iv;
+        resetNonces();
         m_initialized = true;
     }
 
     void CryptoEngine::initializeFromPassword(const std::string& password, const std::vector<uint8_t>& salt) {
         m_key = deriveKey(password, salt);
         m_iv = generateIV();
+        resetNonces();
         m_initialized = true;
     }
 
+    void CryptoEngine::resetNonces() {
+        // One random draw per key; nonces then count up from it
+        if (RAND_bytes(m_noncePrefix.data(), static_cast<int>(m_noncePrefix.size())) != 1) {
+            throw std::runtime_error("Failed to generate random nonce prefix");
+        }
+        m_nonceCounter.store(0);
+    }
+
     bool CryptoEngine::isInitialized() const {
         return m_initialized && !m_key.empty() && !m_iv.empty();
     }
@@ -232,69 +326,45 @@ namespace VaultArchive {
         return plaintext;
     }
 
-    CryptoEngine::EncryptionResult CryptoEngine::encryptAuthenticated(const std::vector<uint8_t>& plaintext) {
-        EncryptionResult result;
-
+    std::unique_ptr<CipherStream> CryptoEngine::createCipherStream(bool encrypt) const {
         if (!isInitialized()) {
             throw std::runtime_error("CryptoEngine not initialized");
         }
 
-        EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+        return std::make_unique<CipherStream>(m_key, m_iv, encrypt);
+    }
 
-        if (!ctx) {
-            throw std::runtime_error("Failed to create cipher context");
+    std::unique_ptr<SegmentCipher> CryptoEngine::createSegmentCipher() const {
+        if (!isInitialized()) {
+            throw std::runtime_error("CryptoEngine not initialized");
         }
 
-        try {
-            // Initialize authenticated encryption
-            if (EVP_EncryptInit_ex(
-                ctx,
-                EVP_aes_256_gcm(),
-                nullptr,
-                m_key.data(),
-                m_iv.data()
-            ) != 1) {
-                throw std::runtime_error("Failed to initialize authenticated encryption");
-            }
-
-            // Calculate required buffer size
-            int blockSize = EVP_CIPHER_CTX_block_size(ctx);
-            result.ciphertext.resize(plaintext.size() + blockSize);
-
-            int outLen1 = 0;
-            int outLen2 = 0;
+        return std::make_unique<SegmentCipher>(m_key);
+    }
 
-            // Encrypt plaintext
-            if (EVP_EncryptUpdate(
-                ctx,
-                result.ciphertext.data(),
-                &outLen1,
-                plaintext.data(),
-                static_cast<int>(plaintext.size())
-            ) != 1) {
-                throw std::runtime_error("Authenticated encryption update failed");
-            }
+    std::unique_ptr<SegmentCipher> CryptoEngine::createSegmentCipher(const uint8_t* header) const {
+        if (!isInitialized()) {
+            throw std::runtime_error("CryptoEngine not initialized");
+        }
 
-            // Finalize encryption
-            if (EVP_EncryptFinal_ex(ctx, result.ciphertext.data() + outLen1, &outLen2) != 1) {
-                throw std::runtime_error("Authenticated encryption finalization failed");
-            }
+        return std::make_unique<SegmentCipher>(m_key, header);
+    }
 
-            result.ciphertext.resize(outLen1 + outLen2);
+    std::unique_ptr<SegmentStream> CryptoEngine::createSegmentStream(bool encrypt, size_t segmentSize) const {
+        if (!isInitialized()) {
+            throw std::runtime_error("CryptoEngine not initialized");
+        }
 
-            // Get authentication tag
-            result.tag.resize(16);  // GCM tag is 16 bytes
-            if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, 16, result.tag.data()) != 1) {
-                throw std::runtime_error("Failed to get authentication tag");
-            }
+        return std::make_unique<SegmentStream>(m_key, encrypt, segmentSize);
+    }
 
-        } catch (...) {
-            EVP_CIPHER_CTX_free(ctx);
-            throw;
+    CryptoEngine::EncryptionResult CryptoEngine::encryptAuthenticated(const std::vector<uint8_t>& plaintext) {
+        if (!isInitialized()) {
+            throw std::runtime_error("CryptoEngine not initialized");
         }
 
-        EVP_CIPHER_CTX_free(ctx);
-        return result;
+        // GCM uses the first 96 bits of the IV
+        return encryptAuthenticated(plaintext, std::vector<uint8_t>(m_iv.begin(), m_iv.begin() + GCM_NONCE_SIZE));
     }
 
     std::vector<uint8_t> CryptoEngine::decryptAuthenticated(
@@ -305,65 +375,84 @@ namespace VaultArchive {
             throw std::runtime_error("CryptoEngine not initialized");
         }
 
-        std::vector<uint8_t> plaintext;
-        EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+        return decryptAuthenticated(ciphertext, tag, std::vector<uint8_t>(m_iv.begin(), m_iv.begin() + GCM_NONCE_SIZE));
+    }
 
-        if (!ctx) {
-            throw std::runtime_error("Failed to create cipher context");
+    CryptoEngine::EncryptionResult CryptoEngine::encryptAuthenticated(
+        const std::vector<uint8_t>& plaintext,
+        const std::vector<uint8_t>& nonce
+    ) const {
+        if (!isInitialized()) {
+            throw std::runtime_error("CryptoEngine not initialized");
+        }
+        if (nonce.size() != GCM_NONCE_SIZE) {
+            throw std::runtime_error("Invalid nonce size for AES-GCM");
         }
 
-        try {
-            // Set expected tag before initialization
-            if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, static_cast<int>(tag.size()),
-                const_cast<uint8_t*>(tag.data())) != 1) {
-                throw std::runtime_error("Failed to set authentication tag");
-            }
+        EncryptionResult result;
+        result.ciphertext.resize(plaintext.size());
+        result.tag.resize(GCM_TAG_SIZE);
+        gcmEncrypt(m_key.data(), nonce.data(), plaintext.data(), plaintext.size(),
+            result.ciphertext.data(), result.tag.data());
+        return result;
+    }
 
-            // Initialize decryption
-            if (EVP_DecryptInit_ex(
-                ctx,
-                EVP_aes_256_gcm(),
-                nullptr,
-                m_key.data(),
-                m_iv.data()
-            ) != 1) {
-                throw std::runtime_error("Failed to initialize authenticated decryption");
-            }
+    std::vector<uint8_t> CryptoEngine::decryptAuthenticated(
+        const std::vector<uint8_t>& ciphertext,
+        const std::vector<uint8_t>& tag,
+        const std::vector<uint8_t>& nonce
+    ) const {
+        if (!isInitialized()) {
+            throw std::runtime_error("CryptoEngine not initialized");
+        }
+        if (nonce.size() != GCM_NONCE_SIZE || tag.size() != GCM_TAG_SIZE) {
+            throw std::runtime_error("Invalid nonce or tag size for AES-GCM");
+        }
 
-            // Allocate output buffer
-            plaintext.resize(ciphertext.size());
+        std::vector<uint8_t> plaintext(ciphertext.size());
+        gcmDecrypt(m_key.data(), nonce.data(), ciphertext.data(), ciphertext.size(), tag.data(), plaintext.data());
+        return plaintext;
+    }
 
-            int outLen1 = 0;
-            int outLen2 = 0;
+    std::vector<uint8_t> CryptoEngine::nextNonce() {
+        if (!isInitialized()) {
+            throw std::runtime_error("CryptoEngine not initialized");
+        }
 
-            // Decrypt ciphertext
-            if (EVP_DecryptUpdate(
-                ctx,
-                plaintext.data(),
-                &outLen1,
-                ciphertext.data(),
-                static_cast<int>(ciphertext.size())
-            ) != 1) {
-                throw std::runtime_error("Authenticated decryption update failed");
-            }
+        uint64_t counter = m_nonceCounter.fetch_add(1);
+        if (counter > 0xFFFFFFFFull) {
+            throw std::runtime_error("AES-GCM nonces exhausted for this key");
+        }
 
-            // Finalize and verify tag
-            int ret = EVP_DecryptFinal_ex(ctx, plaintext.data() + outLen1, &outLen2);
-            if (ret != 1) {
-                throw std::runtime_error("Authentication failed - data has been tampered with or wrong password");
-            }
+        std::vector<uint8_t> nonce(m_noncePrefix.begin(), m_noncePrefix.end());
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            nonce.push_back(static_cast<uint8_t>(counter >> shift));
+        }
+        return nonce;
+    }
 
-            plaintext.resize(outLen1 + outLen2);
+    std::vector<uint8_t> CryptoEngine::seal(const std::vector<uint8_t>& plaintext) {
+        std::vector<uint8_t> nonce = nextNonce();
 
-        } catch (const std::runtime_error&) {
-            EVP_CIPHER_CTX_free(ctx);
-            throw;
-        } catch (...) {
-            EVP_CIPHER_CTX_free(ctx);
-            throw std::runtime_error("Unknown authenticated decryption error");
+        std::vector<uint8_t> sealed(plaintext.size() + SEALED_OVERHEAD);
+        std::copy(nonce.begin(), nonce.end(), sealed.begin());
+        gcmEncrypt(m_key.data(), nonce.data(), plaintext.data(), plaintext.size(),
+            sealed.data() + GCM_NONCE_SIZE, sealed.data() + GCM_NONCE_SIZE + plaintext.size());
+        return sealed;
+    }
+
+    std::vector<uint8_t> CryptoEngine::unseal(const std::vector<uint8_t>& sealed) const {
+        if (!isInitialized()) {
+            throw std::runtime_error("CryptoEngine not initialized");
+        }
+        if (sealed.size() < SEALED_OVERHEAD) {
+            throw std::runtime_error("Encrypted data is truncated");
         }
 
-        EVP_CIPHER_CTX_free(ctx);
+        const size_t length = sealed.size() - SEALED_OVERHEAD;
+        std::vector<uint8_t> plaintext(length);
+        gcmDecrypt(m_key.data(), sealed.data(), sealed.data() + GCM_NONCE_SIZE, length,
+            sealed.data() + GCM_NONCE_SIZE + length, plaintext.data());
         return plaintext;
     }
 
@@ -446,6 +535,163 @@ namespace VaultArchive {
         return oss.str();
     }
 
+    // ======================
+    // KeyCache Implementation
+    // ======================
+
+    KeyCache::KeyCache(size_t capacity, std::chrono::seconds ttl)
+        : m_slots(new Slot[std::max<size_t>(capacity, 1)]()), m_capacity(std::max<size_t>(capacity, 1)),
+          m_ttl(ttl), m_locked(false), m_clock(0) {
+#ifdef _WIN32
+        m_locked = VirtualLock(m_slots, sizeof(Slot) * m_capacity) != 0;
+#else
+        m_locked = mlock(m_slots, sizeof(Slot) * m_capacity) == 0;
+#endif
+    }
+
+    KeyCache::~KeyCache() {
+        clear();
+#ifdef _WIN32
+        if (m_locked) {
+            VirtualUnlock(m_slots, sizeof(Slot) * m_capacity);
+        }
+#else
+        if (m_locked) {
+            munlock(m_slots, sizeof(Slot) * m_capacity);
+        }
+#endif
+        delete[] m_slots;
+    }
+
+    void KeyCache::wipe(Slot& slot) {
+        OPENSSL_cleanse(&slot, sizeof(Slot));
+    }
+
+    void KeyCache::expireLocked(int64_t now) {
+        for (size_t i = 0; i < m_capacity; ++i) {
+            Slot& slot = m_slots[i];
+            if (slot.lastUse != 0 && slot.expires != 0 && slot.expires <= now) {
+                wipe(slot);
+            }
+        }
+    }
+
+    std::vector<uint8_t> KeyCache::deriveKey(
+        const std::string& password,
+        const std::vector<uint8_t>& salt,
+        int iterations
+    ) {
+        if (salt.size() != CryptoEngine::SALT_SIZE) {
+            return CryptoEngine::deriveKey(password, salt, iterations);
+        }
+        if (password.empty()) {
+            throw std::runtime_error("Password cannot be empty for key derivation");
+        }
+
+        std::vector<uint8_t> tag = passwordTag(password, salt);
+        std::vector<uint8_t> key;
+        if (!find(salt, iterations, tag, key)) {
+            // Derive outside the lock; a concurrent miss for the same key only derives twice
+            key = CryptoEngine::deriveKey(password, salt, iterations);
+            insert(salt, iterations, tag, key);
+        }
+        CryptoEngine::secureWipe(tag);
+
+        return key;
+    }
+
+    std::vector<uint8_t> KeyCache::passwordTag(const std::string& password, const std::vector<uint8_t>& salt) {
+        // The password is matched by a salted HMAC, so it is never kept itself
+        std::vector<uint8_t> secret(password.begin(), password.end());
+        std::vector<uint8_t> tag = CryptoEngine::hmacSha256(secret, salt);
+        CryptoEngine::secureWipe(secret);
+        return tag;
+    }
+
+    bool KeyCache::find(const std::vector<uint8_t>& salt, int iterations,
+                        const std::vector<uint8_t>& tag, std::vector<uint8_t>& key) {
+        if (salt.size() != CryptoEngine::SALT_SIZE || tag.size() != CryptoEngine::HASH_SIZE) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        expireLocked(steadySeconds());
+        for (size_t i = 0; i < m_capacity; ++i) {
+            Slot& slot = m_slots[i];
+            if (slot.lastUse != 0 && slot.iterations == iterations &&
+                std::equal(salt.begin(), salt.end(), slot.salt.begin()) &&
+                CRYPTO_memcmp(tag.data(), slot.password.data(), slot.password.size()) == 0) {
+                slot.lastUse = ++m_clock;
+                key.assign(slot.key.begin(), slot.key.end());
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool KeyCache::insert(const std::vector<uint8_t>& salt, int iterations,
+                          const std::vector<uint8_t>& tag, const std::vector<uint8_t>& key) {
+        if (salt.size() != CryptoEngine::SALT_SIZE || tag.size() != CryptoEngine::HASH_SIZE ||
+            key.size() != CryptoEngine::AES_KEY_SIZE) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        int64_t now = steadySeconds();
+        expireLocked(now);
+
+        // Replace an entry for the same salt and password, else a free or the least recently used slot
+        Slot* target = nullptr;
+        for (size_t i = 0; i < m_capacity && !target; ++i) {
+            Slot& slot = m_slots[i];
+            if (slot.lastUse != 0 && slot.iterations == iterations &&
+                std::equal(salt.begin(), salt.end(), slot.salt.begin()) &&
+                CRYPTO_memcmp(tag.data(), slot.password.data(), slot.password.size()) == 0) {
+                target = &slot;
+            }
+        }
+        if (!target) {
+            target = &m_slots[0];
+            for (size_t i = 1; i < m_capacity && target->lastUse != 0; ++i) {
+                if (m_slots[i].lastUse < target->lastUse) {
+                    target = &m_slots[i];
+                }
+            }
+        }
+
+        wipe(*target);
+        std::copy(salt.begin(), salt.end(), target->salt.begin());
+        std::copy(tag.begin(), tag.end(), target->password.begin());
+        std::copy(key.begin(), key.end(), target->key.begin());
+        target->iterations = iterations;
+        target->lastUse = ++m_clock;
+        target->expires = m_ttl.count() > 0 ? now + m_ttl.count() : 0;
+
+        return true;
+    }
+
+    void KeyCache::expire() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        expireLocked(steadySeconds());
+    }
+
+    void KeyCache::clear() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < m_capacity; ++i) {
+            wipe(m_slots[i]);
+        }
+    }
+
+    size_t KeyCache::size() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return static_cast<size_t>(std::count_if(m_slots, m_slots + m_capacity,
+            [](const Slot& slot) { return slot.lastUse != 0; }));
+    }
+
+    bool KeyCache::isLocked() const {
+        return m_locked;
+    }
+
     void CryptoEngine::secureWipe(std::vector<uint8_t>& buffer) {
         if (buffer.empty()) {
             return;
@@ -495,4 +741,240 @@ namespace VaultArchive {
         return bytes;
     }
 
+    // ======================
+    // CipherStream Implementation
+    // ======================
+
+    CipherStream::CipherStream(const std::vector<uint8_t>& key, const std::vector<uint8_t>& iv, bool encrypt)
+        : m_context(EVP_CIPHER_CTX_new()) {
+
+        if (!m_context) {
+            throw std::runtime_error("Failed to create cipher context");
+        }
+
+        if (EVP_CipherInit_ex(m_context, EVP_aes_256_cbc(), nullptr, key.data(), iv.data(),
+                encrypt ? 1 : 0) != 1) {
+            EVP_CIPHER_CTX_free(m_context);
+            throw std::runtime_error(encrypt ? "Failed to initialize encryption" : "Failed to initialize decryption");
+        }
+    }
+
+    CipherStream::~CipherStream() {
+        EVP_CIPHER_CTX_free(m_context);
+    }
+
+    size_t CipherStream::update(const uint8_t* input, size_t length, uint8_t* output) {
+        size_t produced = 0;
+
+        // EVP takes int lengths; feed very large inputs in pieces
+        while (length > 0) {
+            int chunk = static_cast<int>(std::min<size_t>(length, 1 << 30));
+            int outLen = 0;
+            if (EVP_CipherUpdate(m_context, output + produced, &outLen, input, chunk) != 1) {
+                throw std::runtime_error("Cipher update failed (wrong password?)");
+            }
+            input += chunk;
+            length -= static_cast<size_t>(chunk);
+            produced += static_cast<size_t>(outLen);
+        }
+
+        return produced;
+    }
+
+    size_t CipherStream::finalize(uint8_t* output) {
+        int outLen = 0;
+        if (EVP_CipherFinal_ex(m_context, output, &outLen) != 1) {
+            throw std::runtime_error("Cipher finalization failed (corrupted data or wrong password)");
+        }
+        return static_cast<size_t>(outLen);
+    }
+
+    // ======================
+    // SegmentCipher Implementation
+    // ======================
+
+    SegmentCipher::SegmentCipher(const std::vector<uint8_t>& key) {
+        if (key.size() != CryptoEngine::AES_KEY_SIZE) {
+            throw std::runtime_error("Invalid key size for AES-256");
+        }
+
+        m_header.push_back(VERSION);
+        std::vector<uint8_t> random = CryptoEngine::generateRandom(SALT_SIZE + PREFIX_SIZE);
+        m_header.insert(m_header.end(), random.begin(), random.end());
+
+        // Each stream gets its own key, so nonce prefixes of different streams never meet
+        m_key = CryptoEngine::hmacSha256(m_header, key);
+    }
+
+    SegmentCipher::SegmentCipher(const std::vector<uint8_t>& key, const uint8_t* header)
+        : m_header(header, header + HEADER_SIZE) {
+        if (key.size() != CryptoEngine::AES_KEY_SIZE) {
+            throw std::runtime_error("Invalid key size for AES-256");
+        }
+        if (m_header[0] != VERSION) {
+            throw std::runtime_error("Unsupported segmented stream version");
+        }
+
+        m_key = CryptoEngine::hmacSha256(m_header, key);
+    }
+
+    SegmentCipher::~SegmentCipher() {
+        CryptoEngine::secureWipe(m_key);
+    }
+
+    const std::vector<uint8_t>& SegmentCipher::getHeader() const {
+        return m_header;
+    }
+
+    std::array<uint8_t, CryptoEngine::GCM_NONCE_SIZE> SegmentCipher::nonce(uint64_t index, bool last) const {
+        if (index >= MAX_SEGMENTS) {
+            throw std::runtime_error("Too many segments in stream");
+        }
+
+        // Nonce prefix || 32-bit big-endian segment number || last-segment flag
+        std::array<uint8_t, CryptoEngine::GCM_NONCE_SIZE> nonce;
+        std::copy(m_header.begin() + 1 + SALT_SIZE, m_header.end(), nonce.begin());
+        for (size_t i = 0; i < 4; ++i) {
+            nonce[PREFIX_SIZE + i] = static_cast<uint8_t>(index >> (24 - 8 * i));
+        }
+        nonce[PREFIX_SIZE + 4] = last ? 1 : 0;
+        return nonce;
+    }
+
+    size_t SegmentCipher::seal(uint64_t index, bool last, const uint8_t* input, size_t length, uint8_t* output) const {
+        auto segmentNonce = nonce(index, last);
+        gcmEncrypt(m_key.data(), segmentNonce.data(), input, length, output, output + length);
+        return length + TAG_SIZE;
+    }
+
+    size_t SegmentCipher::open(uint64_t index, bool last, const uint8_t* input, size_t length, uint8_t* output) const {
+        if (length < TAG_SIZE) {
+            throw std::runtime_error("Segment is truncated");
+        }
+
+        auto segmentNonce = nonce(index, last);
+        const size_t plainLength = length - TAG_SIZE;
+        gcmDecrypt(m_key.data(), segmentNonce.data(), input, plainLength, input + plainLength, output);
+        return plainLength;
+    }
+
+    uint64_t SegmentCipher::segmentCount(uint64_t plaintextSize, size_t segmentSize) {
+        return plaintextSize == 0 ? 1 : (plaintextSize + segmentSize - 1) / segmentSize;
+    }
+
+    uint64_t SegmentCipher::sealedSize(uint64_t plaintextSize, size_t segmentSize) {
+        return HEADER_SIZE + plaintextSize + segmentCount(plaintextSize, segmentSize) * TAG_SIZE;
+    }
+
+    uint64_t SegmentCipher::segmentOffset(uint64_t index, size_t segmentSize) {
+        return HEADER_SIZE + index * (static_cast<uint64_t>(segmentSize) + TAG_SIZE);
+    }
+
+    // ======================
+    // SegmentStream Implementation
+    // ======================
+
+    SegmentStream::SegmentStream(const std::vector<uint8_t>& key, bool encrypt, size_t segmentSize)
+        : m_key(key), m_encrypt(encrypt), m_segmentSize(segmentSize), m_index(0) {
+        if (segmentSize == 0 || segmentSize > (1u << 30)) {
+            throw std::runtime_error("Invalid segment size");
+        }
+
+        // The decryptor builds its cipher once the header has arrived
+        if (encrypt) {
+            m_cipher = std::make_unique<SegmentCipher>(m_key);
+        } else if (key.size() != CryptoEngine::AES_KEY_SIZE) {
+            throw std::runtime_error("Invalid key size for AES-256");
+        }
+    }
+
+    SegmentStream::~SegmentStream() {
+        CryptoEngine::secureWipe(m_key);
+        CryptoEngine::secureWipe(m_pending);
+        CryptoEngine::secureWipe(m_output);
+    }
+
+    void SegmentStream::update(const uint8_t* input, size_t length, const Output& output) {
+        const size_t unit = m_encrypt ? m_segmentSize : m_segmentSize + SegmentCipher::TAG_SIZE;
+
+        while (length > 0) {
+            if (!m_cipher) {
+                size_t take = std::min(length, SegmentCipher::HEADER_SIZE - m_pending.size());
+                m_pending.insert(m_pending.end(), input, input + take);
+                input += take;
+                length -= take;
+
+                if (m_pending.size() == SegmentCipher::HEADER_SIZE) {
+                    m_cipher = std::make_unique<SegmentCipher>(m_key, m_pending.data());
+                    m_pending.clear();
+                }
+                continue;
+            }
+
+            // A full segment is only known not to be the last once more input follows it
+            if (m_pending.size() == unit) {
+                process(false, output);
+            }
+
+            size_t take = std::min(length, unit - m_pending.size());
+            m_pending.insert(m_pending.end(), input, input + take);
+            input += take;
+            length -= take;
+        }
+    }
+
+    void SegmentStream::finalize(const Output& output) {
+        if (!m_cipher) {
+            throw std::runtime_error("Segmented stream is truncated");
+        }
+
+        process(true, output);
+    }
+
+    void SegmentStream::process(bool last, const Output& output) {
+        if (m_encrypt) {
+            if (m_index == 0) {
+                output(m_cipher->getHeader().data(), m_cipher->getHeader().size());
+            }
+            m_output.resize(m_pending.size() + SegmentCipher::TAG_SIZE);
+            output(m_output.data(), m_cipher->seal(m_index, last, m_pending.data(), m_pending.size(), m_output.data()));
+        } else {
+            if (m_pending.size() < SegmentCipher::TAG_SIZE) {
+                throw std::runtime_error("Segmented stream is truncated");
+            }
+            m_output.resize(m_pending.size() - SegmentCipher::TAG_SIZE);
+            output(m_output.data(), m_cipher->open(m_index, last, m_pending.data(), m_pending.size(), m_output.data()));
+        }
+
+        ++m_index;
+        CryptoEngine::secureWipe(m_pending);
+        m_pending.clear();
+    }
+
+    // ======================
+    // HashStream Implementation
+    // ======================
+
+    HashStream::HashStream() : m_context(EVP_MD_CTX_new()) {
+        if (!m_context || EVP_DigestInit_ex(m_context, EVP_sha256(), nullptr) != 1) {
+            EVP_MD_CTX_free(m_context);
+            throw std::runtime_error("Failed to initialize SHA-256");
+        }
+    }
+
+    HashStream::~HashStream() {
+        EVP_MD_CTX_free(m_context);
+    }
+
+    void HashStream::update(const uint8_t* data, size_t length) {
+        EVP_DigestUpdate(m_context, data, length);
+    }
+
+    std::vector<uint8_t> HashStream::finalize() {
+        std::vector<uint8_t> hash(CryptoEngine::HASH_SIZE);
+        unsigned int hashLength = 0;
+        EVP_DigestFinal_ex(m_context, hash.data(), &hashLength);
+        return hash;
+    }
+
 } // namespace VaultArchive
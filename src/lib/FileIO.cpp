@@ -0,0 +1,748 @@
+/**
+ * @file FileIO.cpp
+ * @brief Low-level file access implementation
+ * @author LotusOS Core
+ * @version 1.0.0
+ */
+
+#include "FileIO.hpp"
+#include <algorithm>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <libgen.h>
+#endif
+
+namespace VaultArchive {
+
+    // ======================
+    // InputFile Implementation
+    // ======================
+
+    InputFile::InputFile()
+        : m_size(0), m_view(nullptr), m_open(false),
+#ifdef _WIN32
+          m_fileHandle(INVALID_HANDLE_VALUE), m_mappingHandle(nullptr) {
+#else
+          m_fd(-1) {
+#endif
+    }
+
+    InputFile::~InputFile() {
+        close();
+    }
+
+    bool InputFile::open(const std::string& path, bool memoryMap) {
+        close();
+
+        if (!openHandle(path)) {
+            return false;
+        }
+
+        // Positioned reads are used whenever the file cannot be mapped
+        if (memoryMap) {
+            map();
+        }
+
+        m_path = path;
+        m_open = true;
+        return true;
+    }
+
+    void InputFile::close() {
+        unmap();
+        closeHandle();
+        m_path.clear();
+        m_size = 0;
+        m_open = false;
+    }
+
+    bool InputFile::isOpen() const {
+        return m_open;
+    }
+
+    bool InputFile::isMapped() const {
+        return m_view != nullptr;
+    }
+
+    uint64_t InputFile::size() const {
+        return m_size;
+    }
+
+    const std::string& InputFile::path() const {
+        return m_path;
+    }
+
+    const uint8_t* InputFile::data() const {
+        return m_view;
+    }
+
+    std::vector<uint8_t> InputFile::read(uint64_t offset, size_t length) const {
+        std::vector<uint8_t> result(length);
+        if (!read(offset, result.data(), length)) {
+            return {};
+        }
+        return result;
+    }
+
+#ifdef _WIN32
+
+    bool InputFile::openHandle(const std::string& path) {
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            CloseHandle(file);
+            return false;
+        }
+
+        m_fileHandle = file;
+        m_size = static_cast<uint64_t>(fileSize.QuadPart);
+        return true;
+    }
+
+    bool InputFile::map() {
+        if (m_size == 0) {
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingA(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            return false;
+        }
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view) {
+            CloseHandle(mapping);
+            return false;
+        }
+
+        m_mappingHandle = mapping;
+        m_view = static_cast<const uint8_t*>(view);
+        return true;
+    }
+
+    void InputFile::unmap() {
+        if (m_view) {
+            UnmapViewOfFile(m_view);
+            m_view = nullptr;
+        }
+        if (m_mappingHandle) {
+            CloseHandle(m_mappingHandle);
+            m_mappingHandle = nullptr;
+        }
+    }
+
+    void InputFile::closeHandle() {
+        if (m_fileHandle != INVALID_HANDLE_VALUE) {
+            CloseHandle(m_fileHandle);
+            m_fileHandle = INVALID_HANDLE_VALUE;
+        }
+    }
+
+    bool InputFile::read(uint64_t offset, uint8_t* buffer, size_t length) const {
+        if (offset > m_size || length > m_size - offset) {
+            return false;
+        }
+
+        if (m_view) {
+            std::memcpy(buffer, m_view + offset, length);
+            return true;
+        }
+
+        while (length > 0) {
+            OVERLAPPED overlapped = {};
+            overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+            DWORD chunk = static_cast<DWORD>(std::min<size_t>(length, 0x40000000));
+            DWORD bytesRead = 0;
+            if (!ReadFile(m_fileHandle, buffer, chunk, &bytesRead, &overlapped) || bytesRead == 0) {
+                return false;
+            }
+
+            buffer += bytesRead;
+            offset += bytesRead;
+            length -= bytesRead;
+        }
+
+        return true;
+    }
+
+    void InputFile::adviseSequential(uint64_t offset, uint64_t length) const {
+        // Windows read-ahead needs no hint for sequential access
+        (void)offset;
+        (void)length;
+    }
+
+#else
+
+    bool InputFile::openHandle(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            return false;
+        }
+
+        m_fd = fd;
+        m_size = static_cast<uint64_t>(st.st_size);
+        return true;
+    }
+
+    bool InputFile::map() {
+        if (m_size == 0) {
+            return false;
+        }
+
+        void* view = mmap(nullptr, static_cast<size_t>(m_size), PROT_READ, MAP_PRIVATE, m_fd, 0);
+        if (view == MAP_FAILED) {
+            return false;
+        }
+
+        m_view = static_cast<const uint8_t*>(view);
+        return true;
+    }
+
+    void InputFile::unmap() {
+        if (m_view) {
+            munmap(const_cast<uint8_t*>(m_view), static_cast<size_t>(m_size));
+            m_view = nullptr;
+        }
+    }
+
+    void InputFile::closeHandle() {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    bool InputFile::read(uint64_t offset, uint8_t* buffer, size_t length) const {
+        if (offset > m_size || length > m_size - offset) {
+            return false;
+        }
+
+        if (m_view) {
+            std::memcpy(buffer, m_view + offset, length);
+            return true;
+        }
+
+        while (length > 0) {
+            ssize_t bytesRead = pread(m_fd, buffer, length, static_cast<off_t>(offset));
+            if (bytesRead < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytesRead <= 0) {
+                return false;
+            }
+
+            buffer += bytesRead;
+            offset += static_cast<uint64_t>(bytesRead);
+            length -= static_cast<size_t>(bytesRead);
+        }
+
+        return true;
+    }
+
+    void InputFile::adviseSequential(uint64_t offset, uint64_t length) const {
+        if (!m_open || offset >= m_size) {
+            return;
+        }
+        length = std::min(length, m_size - offset);
+
+        if (m_view) {
+            // madvise() needs a page-aligned start
+            uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+            uint64_t start = offset - offset % pageSize;
+            madvise(const_cast<uint8_t*>(m_view) + start, static_cast<size_t>(length + (offset - start)),
+                MADV_SEQUENTIAL);
+            return;
+        }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise(m_fd, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+
+#endif
+
+    // ======================
+    // OutputFile Implementation
+    // ======================
+
+    OutputFile::OutputFile()
+        : m_position(0), m_appendStart(0), m_open(false), m_appending(false), m_overwritten(false),
+#ifdef _WIN32
+          m_fileHandle(INVALID_HANDLE_VALUE) {
+#else
+          m_fd(-1) {
+#endif
+    }
+
+    OutputFile::~OutputFile() {
+        abort();
+    }
+
+    bool OutputFile::write(const uint8_t* data, size_t length) {
+        if (!m_open) {
+            return false;
+        }
+
+        // Large writes bypass the buffer
+        if (length >= BUFFER_SIZE) {
+            if (!flush() || !writeRaw(data, length)) {
+                return false;
+            }
+        } else {
+            if (m_buffer.size() + length > BUFFER_SIZE && !flush()) {
+                return false;
+            }
+            m_buffer.insert(m_buffer.end(), data, data + length);
+        }
+
+        m_position += length;
+        return true;
+    }
+
+    bool OutputFile::write(const std::vector<uint8_t>& data) {
+        return write(data.data(), data.size());
+    }
+
+    uint64_t OutputFile::position() const {
+        return m_position;
+    }
+
+    const std::string& OutputFile::targetPath() const {
+        return m_targetPath;
+    }
+
+    bool OutputFile::isAppending() const {
+        return m_appending;
+    }
+
+    bool OutputFile::flush() {
+        if (m_buffer.empty()) {
+            return true;
+        }
+
+        bool ok = writeRaw(m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+        return ok;
+    }
+
+#ifdef _WIN32
+
+    bool OutputFile::create(const std::string& targetPath) {
+        abort();
+
+        for (int attempt = 0; attempt < 100; ++attempt) {
+            std::string tempPath = targetPath + "." + std::to_string(GetCurrentProcessId()) +
+                "." + std::to_string(attempt) + ".tmp";
+
+            HANDLE file = CreateFileA(tempPath.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file != INVALID_HANDLE_VALUE) {
+                m_fileHandle = file;
+                m_tempPath = tempPath;
+                break;
+            }
+            if (GetLastError() != ERROR_FILE_EXISTS) {
+                return false;
+            }
+        }
+
+        if (m_fileHandle == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        m_targetPath = targetPath;
+        m_position = 0;
+        m_buffer.reserve(BUFFER_SIZE);
+        m_open = true;
+        return true;
+    }
+
+    bool OutputFile::append(const std::string& targetPath) {
+        abort();
+
+        // Readers of the archive keep their handles open while it is extended
+        HANDLE file = CreateFileA(targetPath.c_str(), GENERIC_READ | GENERIC_WRITE,
+            FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || !SetFilePointerEx(file, size, nullptr, FILE_BEGIN)) {
+            CloseHandle(file);
+            return false;
+        }
+
+        m_fileHandle = file;
+        m_targetPath = targetPath;
+        m_position = static_cast<uint64_t>(size.QuadPart);
+        m_appendStart = m_position;
+        m_buffer.reserve(BUFFER_SIZE);
+        m_open = true;
+        m_appending = true;
+        m_overwritten = false;
+        return true;
+    }
+
+    bool OutputFile::preallocate(uint64_t size) {
+        FILE_ALLOCATION_INFO info;
+        info.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+        return SetFileInformationByHandle(m_fileHandle, FileAllocationInfo, &info, sizeof(info)) != 0;
+    }
+
+    bool OutputFile::writeRaw(const uint8_t* data, size_t length) {
+        while (length > 0) {
+            DWORD chunk = static_cast<DWORD>(std::min<size_t>(length, 0x40000000));
+            DWORD written = 0;
+            if (!WriteFile(m_fileHandle, data, chunk, &written, nullptr) || written == 0) {
+                return false;
+            }
+            data += written;
+            length -= written;
+        }
+        return true;
+    }
+
+    bool OutputFile::writeAt(uint64_t offset, const uint8_t* data, size_t length) {
+        if (!m_open || offset > m_position || length > m_position - offset || !flush()) {
+            return false;
+        }
+
+        if (offset < m_appendStart) {
+            m_overwritten = true;
+        }
+
+        while (length > 0) {
+            OVERLAPPED overlapped = {};
+            overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+            DWORD chunk = static_cast<DWORD>(std::min<size_t>(length, 0x40000000));
+            DWORD written = 0;
+            if (!WriteFile(m_fileHandle, data, chunk, &written, &overlapped) || written == 0) {
+                return false;
+            }
+            data += written;
+            offset += written;
+            length -= written;
+        }
+
+        // Restore the append position
+        LARGE_INTEGER position;
+        position.QuadPart = static_cast<LONGLONG>(m_position);
+        return SetFilePointerEx(m_fileHandle, position, nullptr, FILE_BEGIN) != 0;
+    }
+
+    bool OutputFile::read(uint64_t offset, uint8_t* buffer, size_t length) {
+        if (!m_open || offset > m_position || length > m_position - offset || !flush()) {
+            return false;
+        }
+
+        while (length > 0) {
+            OVERLAPPED overlapped = {};
+            overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+            DWORD chunk = static_cast<DWORD>(std::min<size_t>(length, 0x40000000));
+            DWORD bytesRead = 0;
+            if (!ReadFile(m_fileHandle, buffer, chunk, &bytesRead, &overlapped) || bytesRead == 0) {
+                return false;
+            }
+            buffer += bytesRead;
+            offset += bytesRead;
+            length -= bytesRead;
+        }
+
+        // Restore the append position
+        LARGE_INTEGER position;
+        position.QuadPart = static_cast<LONGLONG>(m_position);
+        return SetFilePointerEx(m_fileHandle, position, nullptr, FILE_BEGIN) != 0;
+    }
+
+    bool OutputFile::sync() {
+        return m_open && flush() && FlushFileBuffers(m_fileHandle);
+    }
+
+    bool OutputFile::commit() {
+        if (!m_open || !flush()) {
+            return false;
+        }
+
+        // Drop any preallocated space beyond the written data
+        LARGE_INTEGER position;
+        position.QuadPart = static_cast<LONGLONG>(m_position);
+        if (!SetFilePointerEx(m_fileHandle, position, nullptr, FILE_BEGIN) ||
+            !SetEndOfFile(m_fileHandle) || !FlushFileBuffers(m_fileHandle)) {
+            return false;
+        }
+
+        closeHandle();
+
+        if (m_appending) {
+            m_appending = false;
+            m_open = false;
+            return true;
+        }
+
+        if (!MoveFileExA(m_tempPath.c_str(), m_targetPath.c_str(),
+                MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+            return false;
+        }
+
+        m_tempPath.clear();
+        m_open = false;
+        return true;
+    }
+
+    void OutputFile::abort() {
+        // Drop appended data unless the original contents were touched
+        if (m_appending && m_open && !m_overwritten) {
+            LARGE_INTEGER position;
+            position.QuadPart = static_cast<LONGLONG>(m_appendStart);
+            if (SetFilePointerEx(m_fileHandle, position, nullptr, FILE_BEGIN)) {
+                SetEndOfFile(m_fileHandle);
+            }
+        }
+
+        closeHandle();
+        if (!m_tempPath.empty()) {
+            DeleteFileA(m_tempPath.c_str());
+            m_tempPath.clear();
+        }
+        m_buffer.clear();
+        m_position = 0;
+        m_appendStart = 0;
+        m_open = false;
+        m_appending = false;
+        m_overwritten = false;
+    }
+
+    void OutputFile::closeHandle() {
+        if (m_fileHandle != INVALID_HANDLE_VALUE) {
+            CloseHandle(m_fileHandle);
+            m_fileHandle = INVALID_HANDLE_VALUE;
+        }
+    }
+
+#else
+
+    bool OutputFile::create(const std::string& targetPath) {
+        abort();
+
+        for (int attempt = 0; attempt < 100; ++attempt) {
+            std::string tempPath = targetPath + "." + std::to_string(getpid()) +
+                "." + std::to_string(attempt) + ".tmp";
+
+            int fd = ::open(tempPath.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+            if (fd >= 0) {
+                m_fd = fd;
+                m_tempPath = tempPath;
+                break;
+            }
+            if (errno != EEXIST) {
+                return false;
+            }
+        }
+
+        if (m_fd < 0) {
+            return false;
+        }
+
+        // Keep the permissions of the file being replaced
+        struct stat st;
+        if (stat(targetPath.c_str(), &st) == 0) {
+            fchmod(m_fd, st.st_mode & 07777);
+        }
+
+        m_targetPath = targetPath;
+        m_position = 0;
+        m_buffer.reserve(BUFFER_SIZE);
+        m_open = true;
+        return true;
+    }
+
+    bool OutputFile::append(const std::string& targetPath) {
+        abort();
+
+        int fd = ::open(targetPath.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+
+        off_t size = lseek(fd, 0, SEEK_END);
+        if (size < 0) {
+            ::close(fd);
+            return false;
+        }
+
+        m_fd = fd;
+        m_targetPath = targetPath;
+        m_position = static_cast<uint64_t>(size);
+        m_appendStart = m_position;
+        m_buffer.reserve(BUFFER_SIZE);
+        m_open = true;
+        m_appending = true;
+        m_overwritten = false;
+        return true;
+    }
+
+    bool OutputFile::preallocate(uint64_t size) {
+#ifdef __linux__
+        return fallocate(m_fd, 0, 0, static_cast<off_t>(size)) == 0;
+#else
+        (void)size;
+        return false;
+#endif
+    }
+
+    bool OutputFile::writeRaw(const uint8_t* data, size_t length) {
+        while (length > 0) {
+            ssize_t written = ::write(m_fd, data, length);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+            data += written;
+            length -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    bool OutputFile::writeAt(uint64_t offset, const uint8_t* data, size_t length) {
+        if (!m_open || offset > m_position || length > m_position - offset || !flush()) {
+            return false;
+        }
+
+        if (offset < m_appendStart) {
+            m_overwritten = true;
+        }
+
+        while (length > 0) {
+            ssize_t written = pwrite(m_fd, data, length, static_cast<off_t>(offset));
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+            data += written;
+            offset += static_cast<uint64_t>(written);
+            length -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    bool OutputFile::read(uint64_t offset, uint8_t* buffer, size_t length) {
+        if (!m_open || offset > m_position || length > m_position - offset || !flush()) {
+            return false;
+        }
+
+        while (length > 0) {
+            ssize_t bytesRead = pread(m_fd, buffer, length, static_cast<off_t>(offset));
+            if (bytesRead < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytesRead <= 0) {
+                return false;
+            }
+            buffer += bytesRead;
+            offset += static_cast<uint64_t>(bytesRead);
+            length -= static_cast<size_t>(bytesRead);
+        }
+        return true;
+    }
+
+    bool OutputFile::sync() {
+        return m_open && flush() && fsync(m_fd) == 0;
+    }
+
+    bool OutputFile::commit() {
+        if (!m_open || !flush()) {
+            return false;
+        }
+
+        // Drop any preallocated space beyond the written data
+        if (ftruncate(m_fd, static_cast<off_t>(m_position)) != 0 || fsync(m_fd) != 0) {
+            return false;
+        }
+
+        closeHandle();
+
+        if (m_appending) {
+            m_appending = false;
+            m_open = false;
+            return true;
+        }
+
+        if (std::rename(m_tempPath.c_str(), m_targetPath.c_str()) != 0) {
+            return false;
+        }
+
+        // Make the rename itself durable
+        std::vector<char> pathCopy(m_targetPath.begin(), m_targetPath.end());
+        pathCopy.push_back('\0');
+        int dirFd = ::open(dirname(pathCopy.data()), O_RDONLY | O_CLOEXEC);
+        if (dirFd >= 0) {
+            fsync(dirFd);
+            ::close(dirFd);
+        }
+
+        m_tempPath.clear();
+        m_open = false;
+        return true;
+    }
+
+    void OutputFile::abort() {
+        // Drop appended data unless the original contents were touched
+        if (m_appending && m_open && !m_overwritten && ftruncate(m_fd, static_cast<off_t>(m_appendStart)) != 0) {
+            // Unreferenced trailing data is harmless: the header still points at the old index
+        }
+
+        closeHandle();
+        if (!m_tempPath.empty()) {
+            unlink(m_tempPath.c_str());
+            m_tempPath.clear();
+        }
+        m_buffer.clear();
+        m_position = 0;
+        m_appendStart = 0;
+        m_open = false;
+        m_appending = false;
+        m_overwritten = false;
+    }
+
+    void OutputFile::closeHandle() {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+#endif
+
+} // namespace VaultArchive
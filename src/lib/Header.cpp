@@ -13,6 +13,29 @@
 
 namespace VaultArchive {
 
+    namespace {
+
+        constexpr size_t CHUNK_REF_SIZE = 8 + 4 + 4 + CHECKSUM_SIZE;  // Serialized ChunkRef size
+        constexpr size_t SOLID_BLOCK_REF_SIZE = 8 + 4 + 4 + 4;        // Serialized SolidBlockRef size
+
+        // Append an unsigned integer in big-endian byte order
+        void appendUint(std::vector<uint8_t>& data, uint64_t value, int bytes) {
+            for (int i = bytes - 1; i >= 0; --i) {
+                data.push_back(static_cast<uint8_t>((value >> (i * 8)) & 0xFF));
+            }
+        }
+
+        // Read a big-endian unsigned integer
+        uint64_t readUint(const std::vector<uint8_t>& data, size_t offset, int bytes) {
+            uint64_t value = 0;
+            for (int i = 0; i < bytes; ++i) {
+                value = (value << 8) | data[offset + i];
+            }
+            return value;
+        }
+
+    } // namespace
+
     // ======================
     // FileType Implementation
     // ======================
@@ -81,6 +104,24 @@ namespace VaultArchive {
         return BINARY;
     }
 
+    // ======================
+    // KeySlot Implementation
+    // ======================
+
+    KeySlot::KeySlot() {
+        clear();
+    }
+
+    bool KeySlot::isActive() const {
+        return iterations != 0;
+    }
+
+    void KeySlot::clear() {
+        iterations = 0;
+        salt.fill(0);
+        wrappedKey.fill(0);
+    }
+
     // ======================
     // GlobalHeader Implementation
     // ======================
@@ -93,11 +134,16 @@ namespace VaultArchive {
         salt.fill(0);
         iv.fill(0);
         reserved = 0;
+        indexOffset = 0;
+        indexSize = 0;
+        for (auto& slot : keySlots) {
+            slot.clear();
+        }
     }
 
     std::vector<uint8_t> GlobalHeader::serialize() const {
         std::vector<uint8_t> data;
-        data.reserve(64);  // Fixed header size
+        data.reserve(serializedSize());
 
         // Write signature
         data.insert(data.end(), signature.begin(), signature.end());
@@ -125,16 +171,29 @@ namespace VaultArchive {
             data.push_back(i < iv.size() ? iv[i] : 0);
         }
 
-        // Write reserved (8 bytes, big-endian)
-        for (int i = 7; i >= 0; --i) {
-            data.push_back(static_cast<uint8_t>((reserved >> (i * 8)) & 0xFF));
+        // Write reserved (4 bytes, big-endian)
+        appendUint(data, reserved, 4);
+
+        // Write index location (0.4+)
+        if (hasIndex()) {
+            appendUint(data, indexOffset, 8);
+            appendUint(data, indexSize, 8);
+        }
+
+        // Write key slots (0.5+)
+        if (hasKeySlots()) {
+            for (const auto& slot : keySlots) {
+                appendUint(data, slot.iterations, 4);
+                data.insert(data.end(), slot.salt.begin(), slot.salt.end());
+                data.insert(data.end(), slot.wrappedKey.begin(), slot.wrappedKey.end());
+            }
         }
 
         return data;
     }
 
     bool GlobalHeader::deserialize(const std::vector<uint8_t>& data) {
-        if (data.size() < 64) {
+        if (data.size() < GLOBAL_HEADER_SIZE_V3) {
             return false;
         }
 
@@ -174,9 +233,35 @@ namespace VaultArchive {
         offset += IV_SIZE;
 
         // Read reserved
-        reserved = 0;
-        for (int i = 0; i < 8; ++i) {
-            reserved = (reserved << 8) | data[offset + i];
+        reserved = static_cast<uint32_t>(readUint(data, offset, 4));
+        offset += 4;
+
+        // Read index location (0.4+)
+        indexOffset = 0;
+        indexSize = 0;
+        if (hasIndex()) {
+            if (data.size() < GLOBAL_HEADER_SIZE_V4) {
+                return false;
+            }
+            indexOffset = readUint(data, offset, 8);
+            indexSize = readUint(data, offset + 8, 8);
+            offset += 16;
+        }
+
+        // Read key slots (0.5+)
+        for (auto& slot : keySlots) {
+            slot.clear();
+        }
+        if (hasKeySlots()) {
+            if (data.size() < GLOBAL_HEADER_SIZE) {
+                return false;
+            }
+            for (auto& slot : keySlots) {
+                slot.iterations = static_cast<uint32_t>(readUint(data, offset, 4));
+                std::memcpy(slot.salt.data(), data.data() + offset + 4, SALT_SIZE);
+                std::memcpy(slot.wrappedKey.data(), data.data() + offset + 4 + SALT_SIZE, WRAPPED_KEY_SIZE);
+                offset += KEY_SLOT_SIZE;
+            }
         }
 
         return true;
@@ -194,6 +279,26 @@ namespace VaultArchive {
         return (flags & ArchiveFlags::COMPRESSED) != 0;
     }
 
+    bool GlobalHeader::hasIndex() const {
+        return version >= VARC_VERSION_INDEX;
+    }
+
+    bool GlobalHeader::hasKeySlots() const {
+        return version >= VARC_VERSION_KEY_SLOTS;
+    }
+
+    size_t GlobalHeader::activeKeySlots() const {
+        return static_cast<size_t>(std::count_if(keySlots.begin(), keySlots.end(),
+            [](const KeySlot& slot) { return slot.isActive(); }));
+    }
+
+    size_t GlobalHeader::serializedSize() const {
+        if (hasKeySlots()) {
+            return GLOBAL_HEADER_SIZE;
+        }
+        return hasIndex() ? GLOBAL_HEADER_SIZE_V4 : GLOBAL_HEADER_SIZE_V3;
+    }
+
     // ======================
     // EntryHeader Implementation
     // ======================
@@ -279,6 +384,268 @@ namespace VaultArchive {
         return ENTRY_HEADER_SIZE;
     }
 
+    // ======================
+    // IndexEntry Implementation
+    // ======================
+
+    IndexEntry::IndexEntry()
+        : flags(0), fileType(0), originalSize(0), compressedSize(0), dataOffset(0),
+          modificationTime(0) {
+        checksum.fill(0);
+    }
+
+    void IndexEntry::serialize(std::vector<uint8_t>& data) const {
+        appendUint(data, path.length(), 2);
+        appendUint(data, flags, 4);
+        appendUint(data, fileType, 4);
+        appendUint(data, originalSize, 8);
+        appendUint(data, compressedSize, 8);
+        appendUint(data, dataOffset, 8);
+        appendUint(data, modificationTime, 8);
+        data.insert(data.end(), checksum.begin(), checksum.end());
+        appendUint(data, extra.size(), 4);
+
+        data.insert(data.end(), path.begin(), path.end());
+        data.insert(data.end(), extra.begin(), extra.end());
+    }
+
+    size_t IndexEntry::deserialize(const std::vector<uint8_t>& data, size_t offset) {
+        if (data.size() < offset || data.size() - offset < INDEX_ENTRY_SIZE) {
+            return 0;
+        }
+
+        size_t start = offset;
+
+        size_t pathLength = static_cast<size_t>(readUint(data, offset, 2));
+        offset += 2;
+        flags = static_cast<uint32_t>(readUint(data, offset, 4));
+        offset += 4;
+        fileType = static_cast<uint32_t>(readUint(data, offset, 4));
+        offset += 4;
+        originalSize = readUint(data, offset, 8);
+        offset += 8;
+        compressedSize = readUint(data, offset, 8);
+        offset += 8;
+        dataOffset = readUint(data, offset, 8);
+        offset += 8;
+        modificationTime = readUint(data, offset, 8);
+        offset += 8;
+        std::memcpy(checksum.data(), data.data() + offset, CHECKSUM_SIZE);
+        offset += CHECKSUM_SIZE;
+        size_t extraLength = static_cast<size_t>(readUint(data, offset, 4));
+        offset += 4;
+
+        if (data.size() - offset < pathLength + extraLength) {
+            return 0;
+        }
+
+        path.assign(reinterpret_cast<const char*>(data.data() + offset), pathLength);
+        offset += pathLength;
+        extra.assign(data.begin() + offset, data.begin() + offset + extraLength);
+        offset += extraLength;
+
+        return offset - start;
+    }
+
+    void IndexEntry::setExtra(uint16_t tag, const std::vector<uint8_t>& value) {
+        std::vector<uint8_t> records;
+        size_t offset = 0;
+
+        // Keep every other record
+        while (extra.size() - offset >= 6) {
+            uint16_t recordTag = static_cast<uint16_t>(readUint(extra, offset, 2));
+            size_t length = static_cast<size_t>(readUint(extra, offset + 2, 4));
+            if (extra.size() - offset - 6 < length) {
+                break;
+            }
+            if (recordTag != tag) {
+                records.insert(records.end(), extra.begin() + offset, extra.begin() + offset + 6 + length);
+            }
+            offset += 6 + length;
+        }
+
+        appendUint(records, tag, 2);
+        appendUint(records, value.size(), 4);
+        records.insert(records.end(), value.begin(), value.end());
+        extra = std::move(records);
+    }
+
+    bool IndexEntry::findExtra(uint16_t tag, std::vector<uint8_t>& value) const {
+        size_t offset = 0;
+
+        while (extra.size() - offset >= 6) {
+            uint16_t recordTag = static_cast<uint16_t>(readUint(extra, offset, 2));
+            size_t length = static_cast<size_t>(readUint(extra, offset + 2, 4));
+            offset += 6;
+            if (extra.size() - offset < length) {
+                return false;
+            }
+            if (recordTag == tag) {
+                value.assign(extra.begin() + offset, extra.begin() + offset + length);
+                return true;
+            }
+            offset += length;
+        }
+
+        return false;
+    }
+
+    // ======================
+    // BlockIndex Implementation
+    // ======================
+
+    BlockIndex::BlockIndex() : blockSize(0) {
+    }
+
+    std::vector<uint8_t> BlockIndex::serialize() const {
+        std::vector<uint8_t> data;
+        data.reserve(8 + storedSizes.size() * 4);
+
+        appendUint(data, blockSize, 4);
+        appendUint(data, storedSizes.size(), 4);
+        for (uint32_t size : storedSizes) {
+            appendUint(data, size, 4);
+        }
+
+        return data;
+    }
+
+    bool BlockIndex::deserialize(const std::vector<uint8_t>& data) {
+        if (data.size() < 8) {
+            return false;
+        }
+
+        blockSize = static_cast<uint32_t>(readUint(data, 0, 4));
+        size_t count = static_cast<size_t>(readUint(data, 4, 4));
+        if (blockSize == 0 || (data.size() - 8) / 4 != count || (data.size() - 8) % 4 != 0) {
+            return false;
+        }
+
+        storedSizes.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            storedSizes[i] = static_cast<uint32_t>(readUint(data, 8 + i * 4, 4));
+        }
+
+        return true;
+    }
+
+    // ======================
+    // ChunkList Implementation
+    // ======================
+
+    std::vector<uint8_t> ChunkList::serialize() const {
+        std::vector<uint8_t> data;
+        data.reserve(4 + chunks.size() * CHUNK_REF_SIZE);
+
+        appendUint(data, chunks.size(), 4);
+        for (const auto& chunk : chunks) {
+            appendUint(data, chunk.offset, 8);
+            appendUint(data, chunk.storedSize, 4);
+            appendUint(data, chunk.originalSize, 4);
+            data.insert(data.end(), chunk.checksum.begin(), chunk.checksum.end());
+        }
+
+        return data;
+    }
+
+    bool ChunkList::deserialize(const std::vector<uint8_t>& data) {
+        if (data.size() < 4) {
+            return false;
+        }
+
+        size_t count = static_cast<size_t>(readUint(data, 0, 4));
+        if ((data.size() - 4) % CHUNK_REF_SIZE != 0 || (data.size() - 4) / CHUNK_REF_SIZE != count) {
+            return false;
+        }
+
+        chunks.resize(count);
+        size_t offset = 4;
+        for (auto& chunk : chunks) {
+            chunk.offset = readUint(data, offset, 8);
+            chunk.storedSize = static_cast<uint32_t>(readUint(data, offset + 8, 4));
+            chunk.originalSize = static_cast<uint32_t>(readUint(data, offset + 12, 4));
+            std::memcpy(chunk.checksum.data(), data.data() + offset + 16, CHECKSUM_SIZE);
+            offset += CHUNK_REF_SIZE;
+        }
+
+        return true;
+    }
+
+    // ======================
+    // SolidBlockRef Implementation
+    // ======================
+
+    SolidBlockRef::SolidBlockRef() : offset(0), storedSize(0), originalSize(0), entryOffset(0) {}
+
+    std::vector<uint8_t> SolidBlockRef::serialize() const {
+        std::vector<uint8_t> data;
+        data.reserve(SOLID_BLOCK_REF_SIZE);
+
+        appendUint(data, offset, 8);
+        appendUint(data, storedSize, 4);
+        appendUint(data, originalSize, 4);
+        appendUint(data, entryOffset, 4);
+
+        return data;
+    }
+
+    bool SolidBlockRef::deserialize(const std::vector<uint8_t>& data) {
+        if (data.size() != SOLID_BLOCK_REF_SIZE) {
+            return false;
+        }
+
+        offset = readUint(data, 0, 8);
+        storedSize = static_cast<uint32_t>(readUint(data, 8, 4));
+        originalSize = static_cast<uint32_t>(readUint(data, 12, 4));
+        entryOffset = static_cast<uint32_t>(readUint(data, 16, 4));
+
+        return true;
+    }
+
+    // ======================
+    // IndexFooter Implementation
+    // ======================
+
+    IndexFooter::IndexFooter()
+        : signature(VARC_INDEX_SIGNATURE), entryCount(0), indexOffset(0), indexSize(0) {
+        checksum.fill(0);
+    }
+
+    std::vector<uint8_t> IndexFooter::serialize() const {
+        std::vector<uint8_t> data;
+        data.reserve(INDEX_FOOTER_SIZE);
+
+        data.insert(data.end(), signature.begin(), signature.end());
+        appendUint(data, entryCount, 4);
+        appendUint(data, indexOffset, 8);
+        appendUint(data, indexSize, 8);
+        data.insert(data.end(), checksum.begin(), checksum.end());
+
+        return data;
+    }
+
+    bool IndexFooter::deserialize(const std::vector<uint8_t>& data, size_t offset) {
+        if (data.size() < offset || data.size() - offset < INDEX_FOOTER_SIZE) {
+            return false;
+        }
+
+        std::memcpy(signature.data(), data.data() + offset, 4);
+        if (signature != VARC_INDEX_SIGNATURE) {
+            return false;
+        }
+        offset += 4;
+
+        entryCount = static_cast<uint32_t>(readUint(data, offset, 4));
+        offset += 4;
+        indexOffset = readUint(data, offset, 8);
+        offset += 8;
+        indexSize = readUint(data, offset, 8);
+        offset += 8;
+        std::memcpy(checksum.data(), data.data() + offset, CHECKSUM_SIZE);
+
+        return true;
+    }
+
     // ======================
     // ArchiveMetadata Implementation
     // ======================
@@ -0,0 +1,412 @@
+/**
+ * @file KeyAgent.cpp
+ * @brief Key agent implementation
+ * @author LotusOS Core
+ * @version 1.0.0
+ */
+
+#include "KeyAgent.hpp"
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <filesystem>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#endif
+
+namespace VaultArchive {
+
+    namespace {
+
+        // Request: magic, op, iterations (LE), salt, password tag [, key for PUT]
+        // Response: status [, key for a GET hit]
+        const uint8_t MAGIC[4] = {'V', 'A', 'K', '1'};
+        constexpr uint8_t OP_GET = 1;
+        constexpr uint8_t OP_PUT = 2;
+        constexpr uint8_t STATUS_OK = 0;
+        constexpr uint8_t STATUS_MISS = 1;
+        constexpr uint8_t STATUS_ERROR = 2;
+        constexpr size_t REQUEST_SIZE = sizeof(MAGIC) + 1 + 4 + CryptoEngine::SALT_SIZE + CryptoEngine::HASH_SIZE;
+        constexpr int IO_TIMEOUT_SECONDS = 1;
+
+#ifndef _WIN32
+        void setTimeouts(int fd) {
+            struct timeval timeout;
+            timeout.tv_sec = IO_TIMEOUT_SECONDS;
+            timeout.tv_usec = 0;
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+            int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        }
+
+        bool readFully(int fd, uint8_t* data, size_t size) {
+            while (size > 0) {
+                ssize_t received = recv(fd, data, size, 0);
+                if (received < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (received <= 0) {
+                    return false;
+                }
+                data += received;
+                size -= static_cast<size_t>(received);
+            }
+            return true;
+        }
+
+        bool writeFully(int fd, const uint8_t* data, size_t size) {
+#ifdef MSG_NOSIGNAL
+            const int flags = MSG_NOSIGNAL;
+#else
+            const int flags = 0;
+#endif
+            while (size > 0) {
+                ssize_t sent = send(fd, data, size, flags);
+                if (sent < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (sent <= 0) {
+                    return false;
+                }
+                data += sent;
+                size -= static_cast<size_t>(sent);
+            }
+            return true;
+        }
+
+        /**
+         * @brief Check that the other end of a socket runs as the current user
+         * @param fd Connected socket
+         * @return true if the peer's user id is ours
+         */
+        bool peerIsSelf(int fd) {
+#if defined(SO_PEERCRED)
+            struct ucred credentials;
+            socklen_t length = sizeof(credentials);
+            if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0) {
+                return false;
+            }
+            return credentials.uid == geteuid();
+#else
+            uid_t uid;
+            gid_t gid;
+            if (getpeereid(fd, &uid, &gid) != 0) {
+                return false;
+            }
+            return uid == geteuid();
+#endif
+        }
+
+        bool makeAddress(const std::string& path, struct sockaddr_un& address) {
+            std::memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+                return false;
+            }
+            std::memcpy(address.sun_path, path.c_str(), path.size());
+            return true;
+        }
+
+        /**
+         * @brief Connect to an agent owned by the current user
+         * @param path Agent socket
+         * @return Connected socket, or -1
+         */
+        int connectAgent(const std::string& path) {
+            struct sockaddr_un address;
+            if (!makeAddress(path, address)) {
+                return -1;
+            }
+
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0) {
+                return -1;
+            }
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+            setTimeouts(fd);
+
+            if (connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 ||
+                !peerIsSelf(fd)) {
+                close(fd);
+                return -1;
+            }
+            return fd;
+        }
+
+        /**
+         * @brief Send one request to an agent and read the response
+         * @param path Agent socket
+         * @param request Request bytes
+         * @param response Response (resized to the expected size)
+         * @return true if the full response was read
+         */
+        bool exchange(const std::string& path, const std::vector<uint8_t>& request, std::vector<uint8_t>& response) {
+            int fd = connectAgent(path);
+            if (fd < 0) {
+                return false;
+            }
+
+            // The status byte comes first; only a GET hit is followed by the key
+            bool ok = writeFully(fd, request.data(), request.size()) && readFully(fd, response.data(), 1);
+            if (ok && response[0] == STATUS_OK && response.size() > 1) {
+                ok = readFully(fd, response.data() + 1, response.size() - 1);
+            }
+            close(fd);
+            return ok;
+        }
+#endif
+
+        std::vector<uint8_t> makeRequest(uint8_t op, const std::vector<uint8_t>& salt, int iterations,
+                                         const std::vector<uint8_t>& tag) {
+            std::vector<uint8_t> request(MAGIC, MAGIC + sizeof(MAGIC));
+            request.push_back(op);
+            uint32_t count = static_cast<uint32_t>(iterations);
+            for (int shift = 0; shift < 32; shift += 8) {
+                request.push_back(static_cast<uint8_t>(count >> shift));
+            }
+            request.insert(request.end(), salt.begin(), salt.end());
+            request.insert(request.end(), tag.begin(), tag.end());
+            return request;
+        }
+
+    } // namespace
+
+    // ======================
+    // KeyAgent Implementation
+    // ======================
+
+    KeyAgent::KeyAgent(const std::string& socketPath, std::chrono::seconds ttl)
+        : m_socketPath(socketPath), m_cache(CAPACITY, ttl), m_listenFd(-1), m_stopping(false) {
+    }
+
+    KeyAgent::~KeyAgent() {
+#ifndef _WIN32
+        if (m_listenFd >= 0) {
+            close(m_listenFd);
+            unlink(m_socketPath.c_str());
+        }
+#endif
+    }
+
+    bool KeyAgent::start() {
+#ifdef _WIN32
+        m_errorMessage = "The key agent is not supported on this platform";
+        return false;
+#else
+        struct sockaddr_un address;
+        if (!makeAddress(m_socketPath, address)) {
+            m_errorMessage = "Invalid or too long socket path: " + m_socketPath;
+            return false;
+        }
+
+        // The parent directory is created private to the user
+        std::filesystem::path parent = std::filesystem::path(m_socketPath).parent_path();
+        std::error_code ec;
+        if (!parent.empty() && !std::filesystem::exists(parent, ec) && mkdir(parent.c_str(), 0700) != 0) {
+            m_errorMessage = "Cannot create directory: " + parent.string();
+            return false;
+        }
+
+        struct stat info;
+        if (lstat(m_socketPath.c_str(), &info) == 0) {
+            if (!S_ISSOCK(info.st_mode)) {
+                m_errorMessage = "Path exists and is not a socket: " + m_socketPath;
+                return false;
+            }
+            int running = connectAgent(m_socketPath);
+            if (running >= 0) {
+                close(running);
+                m_errorMessage = "A key agent is already running on " + m_socketPath;
+                return false;
+            }
+            unlink(m_socketPath.c_str());
+        }
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            m_errorMessage = std::string("Cannot create socket: ") + std::strerror(errno);
+            return false;
+        }
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+        // Created owner-only so no other user can even connect
+        mode_t previous = umask(0177);
+        int bound = bind(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address));
+        umask(previous);
+        if (bound != 0 || listen(fd, 16) != 0) {
+            m_errorMessage = "Cannot listen on " + m_socketPath + ": " + std::strerror(errno);
+            close(fd);
+            if (bound == 0) {
+                unlink(m_socketPath.c_str());
+            }
+            return false;
+        }
+
+        m_listenFd = fd;
+        return true;
+#endif
+    }
+
+    void KeyAgent::run() {
+#ifndef _WIN32
+        while (m_listenFd >= 0 && !m_stopping.load()) {
+            struct pollfd listener;
+            listener.fd = m_listenFd;
+            listener.events = POLLIN;
+            listener.revents = 0;
+
+            // Wake at least once a second to notice stop() and wipe expired keys
+            int ready = poll(&listener, 1, 1000);
+            m_cache.expire();
+            if (ready <= 0 || m_stopping.load()) {
+                continue;
+            }
+
+            int client = accept(m_listenFd, nullptr, nullptr);
+            if (client < 0) {
+                continue;
+            }
+            serve(client);
+            close(client);
+        }
+#endif
+        m_cache.clear();
+    }
+
+    void KeyAgent::serve(int fd) {
+#ifdef _WIN32
+        (void)fd;
+#else
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        setTimeouts(fd);
+        if (!peerIsSelf(fd)) {
+            return;
+        }
+
+        std::vector<uint8_t> request(REQUEST_SIZE);
+        if (!readFully(fd, request.data(), request.size()) ||
+            !std::equal(MAGIC, MAGIC + sizeof(MAGIC), request.begin())) {
+            return;
+        }
+
+        const uint8_t* field = request.data() + sizeof(MAGIC);
+        uint8_t op = *field++;
+        uint32_t iterations = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            iterations |= static_cast<uint32_t>(*field++) << shift;
+        }
+        std::vector<uint8_t> salt(field, field + CryptoEngine::SALT_SIZE);
+        field += CryptoEngine::SALT_SIZE;
+        std::vector<uint8_t> tag(field, field + CryptoEngine::HASH_SIZE);
+
+        std::vector<uint8_t> response(1, STATUS_ERROR);
+        std::vector<uint8_t> key;
+        if (op == OP_GET) {
+            if (m_cache.find(salt, static_cast<int>(iterations), tag, key)) {
+                response[0] = STATUS_OK;
+                response.insert(response.end(), key.begin(), key.end());
+            } else {
+                response[0] = STATUS_MISS;
+            }
+        } else if (op == OP_PUT) {
+            key.resize(CryptoEngine::AES_KEY_SIZE);
+            if (readFully(fd, key.data(), key.size()) &&
+                m_cache.insert(salt, static_cast<int>(iterations), tag, key)) {
+                response[0] = STATUS_OK;
+            }
+        }
+
+        writeFully(fd, response.data(), response.size());
+        CryptoEngine::secureWipe(key);
+        CryptoEngine::secureWipe(response);
+        CryptoEngine::secureWipe(request);
+        CryptoEngine::secureWipe(tag);
+#endif
+    }
+
+    void KeyAgent::stop() {
+        m_stopping.store(true);
+    }
+
+    const std::string& KeyAgent::getSocketPath() const {
+        return m_socketPath;
+    }
+
+    const std::string& KeyAgent::getLastError() const {
+        return m_errorMessage;
+    }
+
+    bool KeyAgent::isSupported() {
+#ifdef _WIN32
+        return false;
+#else
+        return true;
+#endif
+    }
+
+    std::string KeyAgent::defaultSocketPath() {
+#ifdef _WIN32
+        return std::string();
+#else
+        const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+        if (runtime && *runtime) {
+            return std::string(runtime) + "/varc-agent.sock";
+        }
+        return "/tmp/varc-" + std::to_string(geteuid()) + "/agent.sock";
+#endif
+    }
+
+    bool KeyAgent::fetch(const std::string& socketPath, const std::vector<uint8_t>& salt, int iterations,
+                         const std::vector<uint8_t>& tag, std::vector<uint8_t>& key) {
+#ifdef _WIN32
+        (void)socketPath; (void)salt; (void)iterations; (void)tag; (void)key;
+        return false;
+#else
+        if (salt.size() != CryptoEngine::SALT_SIZE || tag.size() != CryptoEngine::HASH_SIZE) {
+            return false;
+        }
+
+        std::vector<uint8_t> request = makeRequest(OP_GET, salt, iterations, tag);
+        std::vector<uint8_t> response(1 + CryptoEngine::AES_KEY_SIZE);
+        bool hit = exchange(socketPath, request, response) && response[0] == STATUS_OK;
+        if (hit) {
+            key.assign(response.begin() + 1, response.end());
+        }
+        CryptoEngine::secureWipe(response);
+        return hit;
+#endif
+    }
+
+    bool KeyAgent::store(const std::string& socketPath, const std::vector<uint8_t>& salt, int iterations,
+                         const std::vector<uint8_t>& tag, const std::vector<uint8_t>& key) {
+#ifdef _WIN32
+        (void)socketPath; (void)salt; (void)iterations; (void)tag; (void)key;
+        return false;
+#else
+        if (salt.size() != CryptoEngine::SALT_SIZE || tag.size() != CryptoEngine::HASH_SIZE ||
+            key.size() != CryptoEngine::AES_KEY_SIZE) {
+            return false;
+        }
+
+        std::vector<uint8_t> request = makeRequest(OP_PUT, salt, iterations, tag);
+        request.insert(request.end(), key.begin(), key.end());
+        std::vector<uint8_t> response(1);
+        bool stored = exchange(socketPath, request, response) && response[0] == STATUS_OK;
+        CryptoEngine::secureWipe(request);
+        return stored;
+#endif
+    }
+
+} // namespace VaultArchive
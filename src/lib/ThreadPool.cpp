@@ -0,0 +1,134 @@
+/**
+ * @file ThreadPool.cpp
+ * @brief Worker pool implementation
+ * @author LotusOS Core
+ * @version 1.0.0
+ */
+
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <cstdint>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace VaultArchive {
+
+    namespace {
+
+#ifdef __linux__
+        /**
+         * @brief Read the CPU limit imposed by the cgroup CPU quota
+         * @return Number of CPUs allowed (0 if no quota is set)
+         */
+        unsigned int cgroupCpuLimit() {
+            int64_t quota = -1;
+            int64_t period = 0;
+
+            // cgroup v2: "<quota|max> <period>"
+            std::ifstream cpuMax("/sys/fs/cgroup/cpu.max");
+            std::string quotaText;
+            if (cpuMax >> quotaText >> period) {
+                if (quotaText == "max") {
+                    return 0;
+                }
+                try {
+                    quota = std::stoll(quotaText);
+                } catch (...) {
+                    return 0;
+                }
+            } else {
+                // cgroup v1: separate quota and period files (quota -1 = unlimited)
+                std::ifstream quotaFile("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+                std::ifstream periodFile("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+                if (!(quotaFile >> quota) || !(periodFile >> period)) {
+                    return 0;
+                }
+            }
+
+            if (quota <= 0 || period <= 0) {
+                return 0;
+            }
+
+            // Round up so a quota of 1.5 CPUs still gets two workers
+            return static_cast<unsigned int>(std::max<int64_t>(1, (quota + period - 1) / period));
+        }
+#endif
+
+    } // namespace
+
+    // ======================
+    // ThreadPool Implementation
+    // ======================
+
+    ThreadPool::ThreadPool(unsigned int threads) : m_stopping(false) {
+        threads = std::max(1u, threads);
+        m_workers.reserve(threads);
+
+        for (unsigned int i = 0; i < threads; ++i) {
+            m_workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+
+        m_condition.notify_all();
+
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    size_t ThreadPool::size() const {
+        return m_workers.size();
+    }
+
+    unsigned int ThreadPool::availableCores() {
+        unsigned int cores = std::thread::hardware_concurrency();
+
+#ifdef __linux__
+        // CPU affinity (taskset, cpusets)
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet) == 0) {
+            cores = static_cast<unsigned int>(CPU_COUNT(&cpuSet));
+        }
+
+        // Container CPU quota
+        unsigned int limit = cgroupCpuLimit();
+        if (limit > 0) {
+            cores = std::min(cores, limit);
+        }
+#endif
+
+        return std::max(1u, cores);
+    }
+
+    void ThreadPool::workerLoop() {
+        for (;;) {
+            std::function<void()> task;
+
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+                if (m_tasks.empty()) {
+                    return;
+                }
+
+                task = std::move(m_tasks.front());
+                m_tasks.pop();
+            }
+
+            task();
+        }
+    }
+
+} // namespace VaultArchive
@@ -23,13 +23,13 @@ namespace VaultArchive {
 
     VarcEntry::VarcEntry()
         : m_type(Type::FILE), m_originalSize(0), m_compressedSize(0), m_offset(0),
-          m_fileType(0), m_flags(0) {
+          m_fileType(0), m_flags(0), m_loaded(false), m_staged(false) {
     }
 
     VarcEntry::VarcEntry(const std::string& path, const std::vector<uint8_t>& data, Type type)
         : m_relativePath(path), m_type(type), m_originalSize(data.size()),
           m_compressedSize(data.size()), m_offset(0), m_fileType(0), m_flags(0),
-          m_data(data) {
+          m_data(data), m_loaded(true), m_staged(false) {
 
         auto now = std::chrono::system_clock::now();
         m_creationTime = now;
@@ -47,7 +47,7 @@ namespace VaultArchive {
     VarcEntry::VarcEntry(const std::string& path, Type type, uint64_t originalSize, uint32_t fileType)
         : m_relativePath(path), m_type(type), m_originalSize(originalSize),
           m_compressedSize(originalSize), m_offset(0), m_fileType(fileType),
-          m_flags(0) {
+          m_flags(0), m_loaded(false), m_staged(false) {
 
         auto now = std::chrono::system_clock::now();
         m_creationTime = now;
@@ -128,6 +128,18 @@ namespace VaultArchive {
         return (m_flags & EntryFlags::ENCRYPTED) != 0;
     }
 
+    bool VarcEntry::isCompressedFirst() const {
+        return (m_flags & EntryFlags::COMPRESSED_FIRST) != 0;
+    }
+
+    bool VarcEntry::isAuthenticated() const {
+        return (m_flags & EntryFlags::AUTHENTICATED) != 0;
+    }
+
+    bool VarcEntry::isStreamed() const {
+        return (m_flags & EntryFlags::STREAMED) != 0;
+    }
+
     bool VarcEntry::isDirectory() const {
         return m_type == Type::DIRECTORY || (m_flags & EntryFlags::DIRECTORY) != 0;
     }
@@ -136,6 +148,54 @@ namespace VaultArchive {
         return m_type == Type::SYMLINK || (m_flags & EntryFlags::SYMLINK) != 0;
     }
 
+    bool VarcEntry::isBlocked() const {
+        return (m_flags & EntryFlags::BLOCKED) != 0;
+    }
+
+    const BlockIndex& VarcEntry::getBlockIndex() const {
+        return m_blocks;
+    }
+
+    void VarcEntry::setBlockIndex(const BlockIndex& blocks) {
+        m_blocks = blocks;
+        m_flags |= EntryFlags::BLOCKED;
+    }
+
+    bool VarcEntry::isChunked() const {
+        return (m_flags & EntryFlags::CHUNKED) != 0;
+    }
+
+    const ChunkList& VarcEntry::getChunkList() const {
+        return m_chunks;
+    }
+
+    void VarcEntry::setChunkList(const ChunkList& chunks) {
+        m_chunks = chunks;
+        m_flags |= EntryFlags::CHUNKED;
+    }
+
+    bool VarcEntry::isSolid() const {
+        return (m_flags & EntryFlags::SOLID) != 0;
+    }
+
+    const SolidBlockRef& VarcEntry::getSolidBlock() const {
+        return m_solid;
+    }
+
+    void VarcEntry::setSolidBlock(const SolidBlockRef& block) {
+        m_solid = block;
+        m_flags |= EntryFlags::SOLID;
+    }
+
+    uint8_t VarcEntry::getCodec() const {
+        return static_cast<uint8_t>((m_flags & EntryFlags::CODEC_MASK) >> EntryFlags::CODEC_SHIFT);
+    }
+
+    void VarcEntry::setCodec(uint8_t codec) {
+        m_flags = (m_flags & ~EntryFlags::CODEC_MASK) |
+            ((static_cast<uint32_t>(codec) << EntryFlags::CODEC_SHIFT) & EntryFlags::CODEC_MASK);
+    }
+
     std::chrono::system_clock::time_point VarcEntry::getCreationTime() const {
         return m_creationTime;
     }
@@ -166,6 +226,12 @@ namespace VaultArchive {
 
     void VarcEntry::setData(const std::vector<uint8_t>& data) {
         m_data = data;
+        m_loaded = true;
+        m_staged = false;
+        m_blocks = BlockIndex();
+        m_chunks = ChunkList();
+        m_solid = SolidBlockRef();
+        m_flags &= ~(EntryFlags::BLOCKED | EntryFlags::CHUNKED | EntryFlags::SOLID);
         m_originalSize = data.size();
         m_compressedSize = data.size();
         m_checksum = CryptoEngine::sha256(data);
@@ -178,6 +244,12 @@ namespace VaultArchive {
 
     void VarcEntry::setData(std::vector<uint8_t>&& data) {
         m_data = std::move(data);
+        m_loaded = true;
+        m_staged = false;
+        m_blocks = BlockIndex();
+        m_chunks = ChunkList();
+        m_solid = SolidBlockRef();
+        m_flags &= ~(EntryFlags::BLOCKED | EntryFlags::CHUNKED | EntryFlags::SOLID);
         m_originalSize = m_data.size();
         m_compressedSize = m_data.size();
         m_checksum = CryptoEngine::sha256(m_data);
@@ -193,6 +265,19 @@ namespace VaultArchive {
             CryptoEngine::secureWipe(m_data);
         }
         m_data.clear();
+        m_loaded = false;
+    }
+
+    bool VarcEntry::isLoaded() const {
+        return m_loaded;
+    }
+
+    bool VarcEntry::isStaged() const {
+        return m_staged;
+    }
+
+    void VarcEntry::setStaged(bool staged) {
+        m_staged = staged;
     }
 
     EntryHeader VarcEntry::getEntryHeader(uint32_t& pathLength) const {
@@ -206,6 +291,62 @@ namespace VaultArchive {
         return header;
     }
 
+    IndexEntry VarcEntry::getIndexEntry() const {
+        IndexEntry record;
+        record.path = m_relativePath;
+        record.flags = m_flags;
+        record.fileType = m_fileType;
+        record.originalSize = m_originalSize;
+        record.compressedSize = m_compressedSize;
+        record.dataOffset = m_offset;
+        record.modificationTime = static_cast<uint64_t>(
+            std::chrono::system_clock::to_time_t(m_modificationTime));
+        std::copy_n(m_checksum.begin(), std::min(m_checksum.size(), record.checksum.size()),
+            record.checksum.begin());
+
+        if (isBlocked()) {
+            record.setExtra(IndexExtraTag::BLOCK_INDEX, m_blocks.serialize());
+        }
+        if (isChunked()) {
+            record.setExtra(IndexExtraTag::CHUNK_LIST, m_chunks.serialize());
+        }
+        if (isSolid()) {
+            record.setExtra(IndexExtraTag::SOLID_BLOCK, m_solid.serialize());
+        }
+
+        return record;
+    }
+
+    VarcEntry VarcEntry::fromIndexEntry(const IndexEntry& record) {
+        VarcEntry entry(record.path, Type::FILE, record.originalSize, record.fileType);
+        entry.m_compressedSize = record.compressedSize;
+        entry.m_offset = record.dataOffset;
+        entry.m_flags = record.flags;
+        entry.m_checksum.assign(record.checksum.begin(), record.checksum.end());
+        entry.m_modificationTime = std::chrono::system_clock::from_time_t(
+            static_cast<std::time_t>(record.modificationTime));
+
+        // Entries without a readable block index, chunk list or block reference are rejected by readIndex()
+        std::vector<uint8_t> extra;
+        if ((record.flags & EntryFlags::BLOCKED) && record.findExtra(IndexExtraTag::BLOCK_INDEX, extra)) {
+            entry.m_blocks.deserialize(extra);
+        }
+        if ((record.flags & EntryFlags::CHUNKED) && record.findExtra(IndexExtraTag::CHUNK_LIST, extra)) {
+            entry.m_chunks.deserialize(extra);
+        }
+        if ((record.flags & EntryFlags::SOLID) && record.findExtra(IndexExtraTag::SOLID_BLOCK, extra)) {
+            entry.m_solid.deserialize(extra);
+        }
+
+        if (record.flags & EntryFlags::DIRECTORY) {
+            entry.m_type = Type::DIRECTORY;
+        } else if (record.flags & EntryFlags::SYMLINK) {
+            entry.m_type = Type::SYMLINK;
+        }
+
+        return entry;
+    }
+
     std::vector<uint8_t> VarcEntry::getPathData() const {
         std::vector<uint8_t> data(m_relativePath.begin(), m_relativePath.end());
         return data;
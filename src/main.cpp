@@ -6,13 +6,17 @@
  */
 
 #include "Archive.hpp"
+#include "KeyAgent.hpp"
 #include <iostream>
 #include <string>
 #include <vector>
 #include <cstring>
 #include <chrono>
+#include <filesystem>
 #include <iomanip>
 #include <sstream>
+#include <csignal>
+#include <cstdlib>
 
 // Platform-specific includes
 #ifdef _WIN32
@@ -29,8 +33,13 @@ void printVersion();
 void printProgress(uint64_t current, uint64_t total, uint64_t currentBytes,
     uint64_t totalBytes, const std::string& currentFile);
 
-std::string getPassword(bool confirm = false);
+std::string getPassword(bool confirm = false, const char* prompt = "Enter password: ");
 bool parseCompressionLevel(const std::string& value, int& level);
+bool parseThreadCount(const std::string& value, unsigned int& threads);
+bool parseRateLimit(const std::string& value, uint64_t& bytesPerSecond);
+void printRuleStats(const ArchiveResult& result);
+bool parseAgentTtl(const std::string& value, int& seconds);
+int runKeyAgent(const std::string& socketPath, int ttl);
 
 int main(int argc, char* argv[]) {
     // Parse command-line arguments
@@ -39,17 +48,33 @@ int main(int argc, char* argv[]) {
     std::vector<std::string> inputPaths;
     std::string outputDir;
     std::string password;
+    std::string newPassword;
     std::string pattern;
 
     // Options
     bool compress = true;
     int compressionLevel = 6;
+    uint8_t codec = CodecId::DEFLATE;
     bool encrypt = false;
     bool overwrite = false;
     bool showDetails = true;
     bool showChecksums = false;
     bool showTimestamps = true;
     bool humanReadable = true;
+    bool memoryMap = true;
+    unsigned int threads = 0;
+    bool deduplicate = false;
+    bool chunkDedup = false;
+    bool solid = false;
+    bool compareChecksums = false;
+    uint64_t rateLimit = 0;
+    CompressionPolicy policy;
+    std::string policyFile;
+    bool showStats = false;
+    std::string agentSocket;
+    int agentTtl = KeyAgent::DEFAULT_TTL;
+    bool addPassword = false;
+    bool removePassword = false;
 
     // Parse arguments
     for (int i = 1; i < argc; ++i) {
@@ -70,6 +95,106 @@ int main(int argc, char* argv[]) {
             continue;
         }
 
+        if (arg == "--codec") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --codec requires a value\n";
+                return 1;
+            }
+            std::string name = argv[++i];
+            const Codec* selected = CodecRegistry::find(name);
+            if (!selected) {
+                std::cerr << "Error: Unknown or unavailable codec: " << name << "\n";
+                std::cerr << "Available codecs:";
+                for (const auto& available : CodecRegistry::names()) {
+                    std::cerr << " " << available;
+                }
+                std::cerr << "\n";
+                return 1;
+            }
+            codec = selected->id();
+            continue;
+        }
+
+        if (arg == "--policy") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --policy requires a file or 'default'\n";
+                return 1;
+            }
+            policyFile = argv[++i];
+            continue;
+        }
+
+        if (arg == "--policy-rule") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --policy-rule requires a rule\n";
+                return 1;
+            }
+            std::string error;
+            if (!policy.addRule(argv[++i], error)) {
+                std::cerr << "Error: " << error << "\n";
+                return 1;
+            }
+            continue;
+        }
+
+        if (arg == "--stats") {
+            showStats = true;
+            continue;
+        }
+
+        if (arg == "--socket") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --socket requires a path\n";
+                return 1;
+            }
+            agentSocket = argv[++i];
+            continue;
+        }
+
+        if (arg == "--ttl") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --ttl requires a value\n";
+                return 1;
+            }
+            if (!parseAgentTtl(argv[++i], agentTtl)) {
+                std::cerr << "Error: Invalid key lifetime\n";
+                return 1;
+            }
+            continue;
+        }
+
+        if (arg == "--dedup") {
+            deduplicate = true;
+            continue;
+        }
+
+        if (arg == "--chunk-dedup") {
+            chunkDedup = true;
+            continue;
+        }
+
+        if (arg == "--solid") {
+            solid = true;
+            continue;
+        }
+
+        if (arg == "--checksum") {
+            compareChecksums = true;
+            continue;
+        }
+
+        if (arg == "--rate-limit") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --rate-limit requires a value\n";
+                return 1;
+            }
+            if (!parseRateLimit(argv[++i], rateLimit)) {
+                std::cerr << "Error: Invalid rate limit\n";
+                return 1;
+            }
+            continue;
+        }
+
         if (arg == "--compress-level") {
             if (i + 1 >= argc) {
                 std::cerr << "Error: --compress-level requires a value\n";
@@ -82,6 +207,18 @@ int main(int argc, char* argv[]) {
             continue;
         }
 
+        if (arg == "--threads" || arg == "-j") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --threads requires a value\n";
+                return 1;
+            }
+            if (!parseThreadCount(argv[++i], threads)) {
+                std::cerr << "Error: Invalid thread count\n";
+                return 1;
+            }
+            continue;
+        }
+
         if (arg == "--encrypt" || arg == "-e") {
             encrypt = true;
             continue;
@@ -96,6 +233,25 @@ int main(int argc, char* argv[]) {
             continue;
         }
 
+        if (arg == "--new-password") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --new-password requires a value\n";
+                return 1;
+            }
+            newPassword = argv[++i];
+            continue;
+        }
+
+        if (arg == "--add") {
+            addPassword = true;
+            continue;
+        }
+
+        if (arg == "--remove") {
+            removePassword = true;
+            continue;
+        }
+
         if (arg == "--overwrite" || arg == "-o") {
             overwrite = true;
             continue;
@@ -105,6 +261,11 @@ int main(int argc, char* argv[]) {
             continue;  // Suppress progress output
         }
 
+        if (arg == "--no-mmap") {
+            memoryMap = false;
+            continue;
+        }
+
         if (arg == "--raw") {
             showChecksums = false;
             showTimestamps = false;
@@ -127,8 +288,46 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
+    // Without --socket, the agent socket comes from the environment or the default location
+    if (agentSocket.empty()) {
+        const char* fromEnvironment = std::getenv(KeyAgent::SOCKET_ENV);
+        if (fromEnvironment && *fromEnvironment) {
+            agentSocket = fromEnvironment;
+        } else if (command == "agent") {
+            agentSocket = KeyAgent::defaultSocketPath();
+        } else {
+            std::error_code ec;
+            std::string defaultSocket = KeyAgent::defaultSocketPath();
+            if (!defaultSocket.empty() && std::filesystem::exists(defaultSocket, ec)) {
+                agentSocket = defaultSocket;
+            }
+        }
+    }
+
+    if (command == "agent") {
+        return runKeyAgent(agentSocket, agentTtl);
+    }
+
+    // Rules given with --policy-rule take precedence over the policy file
+    if (policyFile == "default") {
+        CompressionPolicy builtIn = CompressionPolicy::defaults();
+        for (const auto& rule : builtIn.getRules()) {
+            policy.addRule(rule);
+        }
+    } else if (!policyFile.empty()) {
+        std::string error;
+        if (!policy.load(policyFile, error)) {
+            std::cerr << "Error: " << error << "\n";
+            return 1;
+        }
+    }
+
     try {
         Archive archive;
+        archive.setKeyAgent(agentSocket);
+
+        OpenOptions openOptions;
+        openOptions.memoryMap = memoryMap;
 
         if (command == "create" || command == "c" || command == "pack") {
             if (archivePath.empty() || inputPaths.empty()) {
@@ -143,10 +342,16 @@ int main(int argc, char* argv[]) {
             }
 
             CreateOptions options;
-            options.compress = compress;
+            options.compress = compress && codec != CodecId::STORE;
+            options.codec = codec;
             options.compressionLevel = compressionLevel;
             options.encrypt = encrypt;
             options.password = password;
+            options.threads = threads;
+            options.deduplicate = deduplicate;
+            options.chunkDedup = chunkDedup;
+            options.solid = solid;
+            options.policy = policy;
 
             // Create archive
             if (!archive.create(archivePath)) {
@@ -169,7 +374,11 @@ int main(int argc, char* argv[]) {
                       << static_cast<double>(result.bytesProcessed) / 1024.0 << " KB\n";
 
             if (encrypt) {
-                std::cout << "Encryption: AES-256-CBC\n";
+                std::cout << "Encryption: AES-256-GCM\n";
+            }
+
+            if (showStats) {
+                printRuleStats(result);
             }
 
         } else if (command == "extract" || command == "x" || command == "unpack") {
@@ -190,7 +399,7 @@ int main(int argc, char* argv[]) {
             }
 
             // Open archive
-            if (!archive.open(archivePath, password)) {
+            if (!archive.open(archivePath, password, openOptions)) {
                 std::cerr << "Error: Failed to open archive: " << archive.getLastError() << "\n";
                 return 1;
             }
@@ -200,6 +409,7 @@ int main(int argc, char* argv[]) {
             ExtractOptions options;
             options.outputDirectory = outputDir;
             options.overwrite = overwrite;
+            options.threads = threads;
 
             ArchiveResult result = archive.extractAll(outputDir, password, options);
 
@@ -217,7 +427,7 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
 
-            if (!archive.open(archivePath)) {
+            if (!archive.open(archivePath, "", openOptions)) {
                 std::cerr << "Error: Failed to open archive: " << archive.getLastError() << "\n";
                 return 1;
             }
@@ -230,6 +440,20 @@ int main(int argc, char* argv[]) {
 
             std::cout << archive.list(options);
 
+        } else if (command == "info" || command == "i") {
+            if (archivePath.empty()) {
+                std::cerr << "Error: Missing archive path\n";
+                std::cerr << "Usage: varc info <archive.varc>\n";
+                return 1;
+            }
+
+            if (!archive.open(archivePath, password, openOptions)) {
+                std::cerr << "Error: Failed to open archive: " << archive.getLastError() << "\n";
+                return 1;
+            }
+
+            std::cout << archive.getSummary();
+
         } else if (command == "verify" || command == "v") {
             if (archivePath.empty()) {
                 std::cerr << "Error: Missing archive path\n";
@@ -237,7 +461,7 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
 
-            if (!archive.open(archivePath, password)) {
+            if (!archive.open(archivePath, password, openOptions)) {
                 std::cerr << "Error: Failed to open archive: " << archive.getLastError() << "\n";
                 return 1;
             }
@@ -260,7 +484,7 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
 
-            if (!archive.open(archivePath, password)) {
+            if (!archive.open(archivePath, password, openOptions)) {
                 std::cerr << "Error: Failed to open archive: " << archive.getLastError() << "\n";
                 return 1;
             }
@@ -268,9 +492,16 @@ int main(int argc, char* argv[]) {
             archive.setProgressCallback(printProgress);
 
             CreateOptions options;
-            options.compress = compress;
+            options.compress = compress && codec != CodecId::STORE;
+            options.codec = codec;
+            options.compressionLevel = compressionLevel;
             options.encrypt = !password.empty();
             options.password = password;
+            options.threads = threads;
+            options.deduplicate = deduplicate;
+            options.chunkDedup = chunkDedup;
+            options.solid = solid;
+            options.policy = policy;
 
             ArchiveResult result = archive.addFiles(inputPaths, options);
 
@@ -281,6 +512,51 @@ int main(int argc, char* argv[]) {
 
             std::cout << "Added " << result.filesProcessed << " files to archive\n";
 
+            if (showStats) {
+                printRuleStats(result);
+            }
+
+        } else if (command == "update" || command == "u") {
+            if (archivePath.empty() || inputPaths.empty()) {
+                std::cerr << "Error: Missing required arguments\n";
+                std::cerr << "Usage: varc update <archive.varc> <files...>\n";
+                return 1;
+            }
+
+            if (!archive.open(archivePath, password, openOptions)) {
+                std::cerr << "Error: Failed to open archive: " << archive.getLastError() << "\n";
+                return 1;
+            }
+
+            archive.setProgressCallback(printProgress);
+
+            CreateOptions options;
+            options.compress = compress && codec != CodecId::STORE;
+            options.codec = codec;
+            options.compressionLevel = compressionLevel;
+            options.encrypt = !password.empty();
+            options.password = password;
+            options.threads = threads;
+            options.deduplicate = deduplicate;
+            options.chunkDedup = chunkDedup;
+            options.solid = solid;
+            options.policy = policy;
+            options.compareChecksums = compareChecksums;
+
+            ArchiveResult result = archive.updateFiles(inputPaths, options);
+
+            // Nothing changed: leave the archive file untouched
+            if (archive.isModified() && !archive.save()) {
+                std::cerr << "Error: Failed to save archive: " << archive.getLastError() << "\n";
+                return 1;
+            }
+
+            std::cout << "Updated " << result.filesProcessed << " files (" << result.message << ")\n";
+
+            if (showStats) {
+                printRuleStats(result);
+            }
+
         } else if (command == "remove" || command == "rm") {
             if (archivePath.empty() || inputPaths.empty()) {
                 std::cerr << "Error: Missing required arguments\n";
@@ -288,7 +564,7 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
 
-            if (!archive.open(archivePath, password)) {
+            if (!archive.open(archivePath, password, openOptions)) {
                 std::cerr << "Error: Failed to open archive: " << archive.getLastError() << "\n";
                 return 1;
             }
@@ -305,6 +581,33 @@ int main(int argc, char* argv[]) {
 
             std::cout << "Removed " << removed << " entries from archive\n";
 
+        } else if (command == "compact") {
+            if (archivePath.empty()) {
+                std::cerr << "Error: Missing archive path\n";
+                std::cerr << "Usage: varc compact <archive.varc>\n";
+                return 1;
+            }
+
+            if (!archive.open(archivePath, password, openOptions)) {
+                std::cerr << "Error: Failed to open archive: " << archive.getLastError() << "\n";
+                return 1;
+            }
+
+            uint64_t unused = archive.getUnusedSize();
+            uint64_t sizeBefore = std::filesystem::file_size(archivePath);
+
+            CompactOptions options;
+            options.bytesPerSecond = rateLimit;
+
+            if (!archive.compact(options)) {
+                std::cerr << "Error: Failed to compact archive: " << archive.getLastError() << "\n";
+                return 1;
+            }
+
+            std::cout << "Reclaimed " << archive.formatSize(unused) << " ("
+                      << archive.formatSize(sizeBefore) << " -> "
+                      << archive.formatSize(std::filesystem::file_size(archivePath)) << ")\n";
+
         } else if (command == "lock") {
             if (archivePath.empty()) {
                 std::cerr << "Error: Missing archive path\n";
@@ -316,7 +619,7 @@ int main(int argc, char* argv[]) {
                 password = getPassword(true);
             }
 
-            if (!archive.open(archivePath)) {
+            if (!archive.open(archivePath, "", openOptions)) {
                 std::cerr << "Error: Failed to open archive: " << archive.getLastError() << "\n";
                 return 1;
             }
@@ -344,7 +647,7 @@ int main(int argc, char* argv[]) {
                 password = getPassword(false);
             }
 
-            if (!archive.open(archivePath, password)) {
+            if (!archive.open(archivePath, password, openOptions)) {
                 std::cerr << "Error: Failed to unlock archive: " << archive.getLastError() << "\n";
                 return 1;
             }
@@ -361,6 +664,47 @@ int main(int argc, char* argv[]) {
 
             std::cout << "Archive unlocked successfully\n";
 
+        } else if (command == "passwd") {
+            if (archivePath.empty()) {
+                std::cerr << "Error: Missing archive path\n";
+                std::cerr << "Usage: varc passwd [--add | --remove] <archive.varc>\n";
+                return 1;
+            }
+
+            if (addPassword && removePassword) {
+                std::cerr << "Error: --add and --remove cannot be combined\n";
+                return 1;
+            }
+
+            if (password.empty()) {
+                password = getPassword(false, removePassword ? "Password to remove: " : "Current password: ");
+            }
+
+            if (!archive.open(archivePath, password, openOptions)) {
+                std::cerr << "Error: Failed to open archive: " << archive.getLastError() << "\n";
+                return 1;
+            }
+
+            if (!removePassword && newPassword.empty()) {
+                newPassword = getPassword(true, "New password: ");
+            }
+
+            bool changed = removePassword ? archive.removePassword(password) :
+                addPassword ? archive.addPassword(password, newPassword) :
+                archive.changePassword(password, newPassword);
+            if (!changed) {
+                std::cerr << "Error: Failed to update passwords: " << archive.getLastError() << "\n";
+                return 1;
+            }
+
+            if (!archive.save()) {
+                std::cerr << "Error: Failed to save archive: " << archive.getLastError() << "\n";
+                return 1;
+            }
+
+            std::cout << (removePassword ? "Password removed" : addPassword ? "Password added" : "Password changed")
+                      << " (" << archive.getPasswordCount() << " of " << KEY_SLOT_COUNT << " key slots in use)\n";
+
         } else {
             std::cerr << "Error: Unknown command: " << command << "\n";
             std::cerr << "Use 'varc --help' for usage information\n";
@@ -391,11 +735,16 @@ COMMANDS:
     create, c, pack   Create a new archive
     extract, x, unpack Extract files from archive
     list, l           List archive contents
+    info, i           Show archive summary
     verify, v         Verify archive integrity
     add, a            Add files to existing archive
+    update, u         Add new and changed files, skipping unchanged ones
     remove, rm        Remove files from archive
+    compact           Reclaim space left by removed and replaced files
     lock              Encrypt/lock archive with password
     unlock            Decrypt/unlock archive
+    passwd            Change, add (--add) or remove (--remove) a password
+    agent             Keep derived keys for other varc runs (foreground)
     help              Show this help message
     version           Show version information
 
@@ -403,8 +752,21 @@ OPTIONS:
     --help, -h        Show help
     --version, -v     Show version
     --password, -p    Specify password for encryption
+    --new-password PW New password (passwd; prompted for if omitted)
     --encrypt, -e     Enable encryption for archive
     --no-compress     Disable compression
+    --codec NAME      Compression codec: deflate (default), zstd, lz4, store
+                      (create/add/update; zstd and lz4 only if built in)
+    --dedup           Store identical files only once (create/add)
+    --chunk-dedup     Store identical chunks only once (create/add)
+    --solid           Compress small files together in solid blocks (create/add)
+    --policy FILE     Choose codec, level and solid packing per file from the
+                      rules in FILE, or the built-in rules with 'default'
+                      (create/add/update)
+    --policy-rule R   Add one policy rule; repeatable, checked before --policy
+    --stats           Show files and sizes per policy rule (create/add/update)
+    --checksum        Also compare SHA-256 of files that look unchanged (update)
+    --rate-limit MB   Limit compaction to MB MiB/s of copied data (compact)
     --compress-level  Set compression level (0-9)
                       0 = No compression
                       1-3 = Fast compression
@@ -413,11 +775,22 @@ OPTIONS:
     --overwrite, -o   Overwrite existing files
     --quiet, -q       Suppress progress output
     --raw             Raw output (no formatting)
+    --no-mmap         Read the archive instead of memory-mapping it
+    --threads, -j N   Worker threads for create/add/extract (default: available cores)
+    --socket PATH     Key agent socket (default: $VARC_AGENT_SOCK, then
+                      $XDG_RUNTIME_DIR/varc-agent.sock or /tmp/varc-<uid>/agent.sock)
+    --ttl SECONDS     Lifetime of keys held by the agent (default: 600)
 
 EXAMPLES:
     # Create an archive
     varc create backup.varc ./documents
 
+    # Create an archive compressed with zstd
+    varc create --codec zstd backup.varc ./documents
+
+    # Store media, pack small files solid and show what each rule did
+    varc create --policy default --stats backup.varc ./documents
+
     # Create encrypted archive
     varc create --encrypt backup.varc ./documents
 
@@ -433,12 +806,26 @@ EXAMPLES:
     # Add files to archive
     varc add backup.varc ./new_files
 
+    # Refresh archive with new and changed files
+    varc update backup.varc ./documents
+
+    # Reclaim space after removing files, at most 50 MiB/s
+    varc compact --rate-limit 50 backup.varc
+
     # Lock archive with password
     varc lock secure.varc
 
     # Unlock archive
     varc unlock secure.varc
 
+    # Change the password, or give a second person their own password
+    varc passwd secure.varc
+    varc passwd --add secure.varc
+
+    # Keep keys for 10 minutes so repeated runs skip key derivation
+    varc agent --ttl 600 &
+    varc verify -p secret secure.varc
+
 )";
 
     std::cout << "\nFor more information, see USER_GUIDE.md\n";
@@ -450,8 +837,8 @@ VaultArchive Version 0.3.27
 ===========================
 
 Features:
-  - AES-256-CBC encryption
-  - Zlib compression (DEFLATE algorithm)
+  - AES-256-GCM authenticated encryption
+  - Zlib compression (DEFLATE algorithm), optional zstd and lz4
   - SHA-256 integrity verification
   - Multi-file archives
   - Cross-platform (Windows, Linux, macOS)
@@ -492,11 +879,11 @@ void printProgress(uint64_t current, uint64_t total, uint64_t currentBytes,
     std::cout << std::flush;
 }
 
-std::string getPassword(bool confirm) {
+std::string getPassword(bool confirm, const char* prompt) {
     std::string password;
     std::string confirmPassword;
 
-    std::cout << "Enter password: ";
+    std::cout << prompt;
     std::getline(std::cin, password);
 
     if (confirm) {
@@ -520,3 +907,93 @@ bool parseCompressionLevel(const std::string& value, int& level) {
         return false;
     }
 }
+
+bool parseThreadCount(const std::string& value, unsigned int& threads) {
+    try {
+        int count = std::stoi(value);
+        if (count < 1 || count > 1024) {
+            return false;
+        }
+        threads = static_cast<unsigned int>(count);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool parseAgentTtl(const std::string& value, int& seconds) {
+    try {
+        int count = std::stoi(value);
+        if (count < 1 || count > 7 * 24 * 3600) {
+            return false;
+        }
+        seconds = count;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool parseRateLimit(const std::string& value, uint64_t& bytesPerSecond) {
+    try {
+        double mebibytes = std::stod(value);
+        if (mebibytes <= 0.0 || mebibytes > 1024.0 * 1024.0) {
+            return false;
+        }
+        bytesPerSecond = static_cast<uint64_t>(mebibytes * 1024.0 * 1024.0);
+        return bytesPerSecond > 0;
+    } catch (...) {
+        return false;
+    }
+}
+
+void printRuleStats(const ArchiveResult& result) {
+    if (result.ruleStats.empty()) {
+        return;
+    }
+
+    std::cout << "\nPolicy rule statistics:\n";
+    for (const auto& [rule, stats] : result.ruleStats) {
+        double ratio = stats.totalOriginalSize > 0
+            ? 100.0 * static_cast<double>(stats.totalCompressedSize) / stats.totalOriginalSize
+            : 100.0;
+        std::cout << "  " << (rule.empty() ? "(archive settings)" : rule) << "\n"
+                  << "      " << stats.filesProcessed << " files, "
+                  << CompressionStats::formatSize(stats.totalOriginalSize) << " -> "
+                  << CompressionStats::formatSize(stats.totalCompressedSize) << " ("
+                  << std::fixed << std::setprecision(1) << ratio << "%)\n";
+    }
+}
+
+namespace {
+    KeyAgent* runningAgent = nullptr;
+
+    void stopKeyAgent(int) {
+        if (runningAgent) {
+            runningAgent->stop();
+        }
+    }
+}
+
+int runKeyAgent(const std::string& socketPath, int ttl) {
+    KeyAgent agent(socketPath, std::chrono::seconds(ttl));
+    if (!agent.start()) {
+        std::cerr << "Error: " << agent.getLastError() << "\n";
+        return 1;
+    }
+
+    runningAgent = &agent;
+    std::signal(SIGINT, stopKeyAgent);
+    std::signal(SIGTERM, stopKeyAgent);
+#ifndef _WIN32
+    std::signal(SIGHUP, stopKeyAgent);
+#endif
+
+    std::cout << KeyAgent::SOCKET_ENV << "=" << agent.getSocketPath() << "; export "
+              << KeyAgent::SOCKET_ENV << ";\n";
+    std::cout << "# Key agent running, keys kept for " << ttl << " s (Ctrl+C to stop)" << std::endl;
+
+    agent.run();
+    runningAgent = nullptr;
+    return 0;
+}